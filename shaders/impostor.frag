@@ -0,0 +1,61 @@
+#version 410 core
+precision highp float;
+precision highp sampler2DArrayShadow;
+
+#define SHADOW_CASCADES 4
+
+in vec2 texCoord;
+in vec3 fragPos;
+
+uniform sampler2D impostorAtlas;
+
+struct DirectionalLight {
+    vec3 direction;
+    vec3 color;
+    mat4 cascades[SHADOW_CASCADES]; // nearest cascade first
+};
+
+uniform DirectionalLight sun;
+uniform bool hasSun;
+uniform sampler2DArrayShadow sunShadow;
+
+uniform vec3 ambientLight;
+
+out vec4 out_color;
+
+vec3 CalcSun()
+{
+    // use the nearest cascade that covers the fragment
+    for (int i = 0; i < SHADOW_CASCADES; ++i) {
+        vec3 projCoords = (sun.cascades[i] * vec4(fragPos, 1.0)).xyz * 0.5 + 0.5;
+        if (any(lessThan(projCoords, vec3(0.0))) || any(greaterThan(projCoords, vec3(1.0)))) {
+            continue;
+        }
+        // far away, so a single bilinear compare is enough
+        return texture(sunShadow, vec4(projCoords.xy, float(i), projCoords.z - 0.002)) * sun.color;
+    }
+    return sun.color;
+}
+
+// lit like the leaves, without normals, by the ambient light and the sun only,
+// as the point lights fall short of the distance impostors are drawn from
+void main()
+{
+    vec4 color = texture(impostorAtlas, texCoord);
+    // the empty texels are black, and get averaged into the mipmaps
+    color.rgb /= max(color.a, 0.0001);
+
+#if ALPHA_TO_COVERAGE
+    color.a = (color.a - 0.5) / max(fwidth(color.a), 0.0001) + 0.5;
+#else
+    if (color.a < 0.5)
+        discard;
+#endif
+
+    vec3 result = ambientLight;
+    if (hasSun) {
+        result += CalcSun();
+    }
+
+    out_color = vec4(result * color.rgb, color.a);
+}
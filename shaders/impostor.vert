@@ -0,0 +1,52 @@
+#version 410 core
+precision highp float;
+
+layout(location = 1) in vec2 vertexTexCoord;
+layout(location = 5) in vec3 offset;
+
+out vec2 texCoord;
+out vec3 fragPos;
+
+uniform mat4 viewProjection;
+uniform vec3 viewPos;
+// the half width of the billboards, and the height of their bottom and their height
+uniform vec3 impostorFrame;
+uniform int impostorVariants;
+// the instances closer than cutoffDistance to cutoffCenter are drawn in full instead
+uniform vec3 cutoffCenter;
+uniform float cutoffDistance;
+
+// the depth prepass relies on both passes computing the exact same depth
+invariant gl_Position;
+
+const float PI = 3.14159265;
+
+void main()
+{
+    texCoord = vertexTexCoord;
+    fragPos = offset;
+    if (distance(offset.xz, cutoffCenter.xz) <= cutoffDistance) {
+        // all the vertices in the same spot, so nothing gets rasterized
+        gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    // turned towards the viewer around the vertical axis only, so that the
+    // trees stay upright
+    vec3 toViewer = vec3(viewPos.x - offset.x, 0.0, viewPos.z - offset.z);
+    toViewer = length(toViewer) > 0.0001 ? normalize(toViewer) : vec3(0.0, 0.0, 1.0);
+    vec3 right = cross(vec3(0.0, 1.0, 0.0), toViewer);
+
+    vec3 worldPosition = offset +
+        right * (vertexTexCoord.x * 2.0 - 1.0) * impostorFrame.x +
+        vec3(0.0, impostorFrame.y + vertexTexCoord.y * impostorFrame.z, 0.0);
+    gl_Position = viewProjection * vec4(worldPosition, 1.0);
+    fragPos = worldPosition;
+
+    // the baked view closest to the direction the tree is seen from
+    float view = mod(floor(atan(toViewer.x, toViewer.z) / (2.0 * PI) * float(IMPOSTOR_VIEWS) + 0.5),
+                     float(IMPOSTOR_VIEWS));
+    float variant = mod(float(gl_InstanceID), float(impostorVariants));
+    texCoord = (vec2(view, variant) + vertexTexCoord) /
+        vec2(float(IMPOSTOR_VIEWS), float(impostorVariants));
+}
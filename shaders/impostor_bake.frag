@@ -0,0 +1,24 @@
+#version 410 core
+precision highp float;
+
+in vec2 texCoord;
+
+uniform sampler2D texture0;
+uniform sampler2D leafTexture;
+// whether the leaves are drawn, rather than the trunk
+uniform bool foliage;
+
+out vec4 out_color;
+
+// writes the unlit color of a tree into an impostor atlas
+void main()
+{
+    if (foliage) {
+        vec4 leafColor = texture(leafTexture, texCoord);
+        if (leafColor.a < 0.5)
+            discard;
+        out_color = vec4(leafColor.rgb, 1.0);
+        return;
+    }
+    out_color = vec4(texture(texture0, texCoord).rgb, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 410 core
+precision highp float;
+
+in vec2 texCoord;
+
+uniform sampler2D impostorAtlas;
+// set in the depth prepass, while the shadow passes still cut the trees out
+uniform bool alphaToCoverage;
+
+out vec4 out_color;
+
+// only writes the depth of the impostors
+void main()
+{
+    float alpha = texture(impostorAtlas, texCoord).a;
+    if (alphaToCoverage) {
+        // sharpened like in impostor.frag, so that both passes cover the same
+        // samples
+        out_color = vec4(0.0, 0.0, 0.0, (alpha - 0.5) / max(fwidth(alpha), 0.0001) + 0.5);
+        return;
+    }
+    if (alpha < 0.5)
+        discard;
+    out_color = vec4(0.0);
+}
@@ -1,7 +1,12 @@
 #version 410 core
 precision highp float;
+precision highp int;
+precision highp usampler2D;
+precision highp sampler2DShadow;
+precision highp sampler2DArrayShadow;
 
 #define MAX_LIGHTS 10
+#define SHADOW_CASCADES 4
 const int smoothing_window = 1;
 
 in vec2 texCoord;
@@ -14,12 +19,85 @@ struct Light {
     vec3 position;
     vec3 color;
     float range;
-    mat4 lightSpaceMatrix;
-    sampler2D depthMap;
+    int shadow; // the index of the shadow map of the light, or -1
 };
 
-uniform Light lights[MAX_LIGHTS];
-uniform int numLights;
+// the lights, sorted into the clusters of the view frustum
+uniform usampler2D clusterGrid; // the offset and the count of the lights of each cluster
+uniform usampler2D lightIndices; // the lights of all the clusters, CLUSTER_INDEX_WIDTH per row
+uniform sampler2D lightData; // two texels per light
+uniform vec4 clusterParams; // clusters per pixel in xy, the depth slice scale and bias in zw
+uniform vec3 viewFront; // the direction the camera looks in
+
+// the lights with shadow maps
+uniform mat4 shadowMatrices[MAX_LIGHTS];
+uniform vec4 shadowRects[MAX_LIGHTS]; // where the depth maps lie in the atlas
+uniform sampler2DShadow shadowAtlas;
+
+struct DirectionalLight {
+    vec3 direction;
+    vec3 color;
+    mat4 cascades[SHADOW_CASCADES]; // nearest cascade first
+};
+
+uniform DirectionalLight sun;
+uniform bool hasSun;
+uniform sampler2DArrayShadow sunShadow;
+
+// the shadow filter, selected at compile time through SHADOW_KERNEL
+#ifndef SHADOW_KERNEL
+#define SHADOW_KERNEL 4
+#endif
+#if SHADOW_KERNEL == 1
+// a single bilinear compare, so a 2x2 filter
+const vec2 shadowKernel[1] = vec2[](vec2(0.0));
+const float kernelScale = 1.0;
+#elif SHADOW_KERNEL == 4
+// four bilinear compares half a texel apart add up to a 3x3 tent filter
+const vec2 shadowKernel[4] = vec2[](vec2(-0.5, -0.5), vec2(0.5, -0.5),
+                              vec2(-0.5, 0.5), vec2(0.5, 0.5));
+const float kernelScale = 1.0;
+#elif SHADOW_KERNEL == 8
+const vec2 shadowKernel[8] = vec2[](vec2(-0.326, -0.406), vec2(-0.840, -0.074),
+                              vec2(-0.696, 0.457), vec2(-0.203, 0.621),
+                              vec2(0.962, -0.195), vec2(0.473, -0.480),
+                              vec2(0.519, 0.767), vec2(0.185, -0.893));
+const float kernelScale = 1.5;
+#elif SHADOW_KERNEL == 16
+const vec2 shadowKernel[16] = vec2[](vec2(-0.942, -0.399), vec2(0.946, -0.769),
+                               vec2(-0.094, -0.929), vec2(0.345, 0.294),
+                               vec2(-0.916, 0.458), vec2(-0.815, -0.879),
+                               vec2(-0.383, 0.277), vec2(0.975, 0.756),
+                               vec2(0.443, -0.975), vec2(0.537, -0.474),
+                               vec2(-0.265, -0.419), vec2(0.792, 0.191),
+                               vec2(-0.242, 0.997), vec2(-0.814, 0.914),
+                               vec2(0.200, 0.786), vec2(0.144, -0.141));
+const float kernelScale = 1.5;
+#else
+#error "SHADOW_KERNEL has to be 1, 4, 8 or 16"
+#endif
+
+// the lit fraction of the kernel around a point of the atlas, kept within a tile
+float FilterAtlas(vec2 coord, float depth, vec2 tileMin, vec2 tileMax)
+{
+    vec2 texelSize = kernelScale / vec2(textureSize(shadowAtlas, 0));
+    float lit = 0.0;
+    for (int i = 0; i < SHADOW_KERNEL; ++i) {
+        lit += texture(shadowAtlas, vec3(clamp(coord + shadowKernel[i] * texelSize, tileMin, tileMax), depth));
+    }
+    return lit / float(SHADOW_KERNEL);
+}
+
+// the lit fraction of the kernel around a point of a cascade
+float FilterCascade(vec2 coord, int cascade, float depth)
+{
+    vec2 texelSize = kernelScale / vec2(textureSize(sunShadow, 0).xy);
+    float lit = 0.0;
+    for (int i = 0; i < SHADOW_KERNEL; ++i) {
+        lit += texture(sunShadow, vec4(coord + shadowKernel[i] * texelSize, float(cascade), depth));
+    }
+    return lit / float(SHADOW_KERNEL);
+}
 
 uniform vec3 viewPos;
 uniform float shininess;
@@ -27,43 +105,101 @@ uniform vec3 ambientLight;
 
 out vec4 out_color;
 
-vec3 CalcLight(Light light)
+// the lights reaching the cluster of the fragment, as an offset and a count
+ivec2 GetCluster()
 {
-    vec3 light_distance = light.position - fragPos;
-    float distance = length(light_distance);
-    vec3 lightDir = normalize(light_distance);
+    float depth = max(dot(fragPos - viewPos, viewFront), 0.0001);
+    int slice = clamp(int(log(depth) * clusterParams.z - clusterParams.w), 0, CLUSTER_Z - 1);
+    ivec2 tile = min(ivec2(gl_FragCoord.xy * clusterParams.xy), ivec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+    return ivec2(texelFetch(clusterGrid, ivec2(tile.x, tile.y + slice * CLUSTER_Y), 0).xy);
+}
+
+Light GetLight(int clusterIndex)
+{
+    int index = int(texelFetch(lightIndices, ivec2(clusterIndex % CLUSTER_INDEX_WIDTH, clusterIndex / CLUSTER_INDEX_WIDTH), 0).r);
+    vec4 positionRange = texelFetch(lightData, ivec2(0, index), 0);
+    vec4 colorShadow = texelFetch(lightData, ivec2(1, index), 0);
+    return Light(positionRange.xyz, colorShadow.rgb, positionRange.w, int(colorShadow.a));
+}
 
-    // Shadow calculation
-    vec4 fragPosLightSpace = light.lightSpaceMatrix * vec4(fragPos, 1.0);
+// the lit fraction of the fragment, as seen from a shadow map
+float CalcShadow(int index, float bias)
+{
+    vec4 fragPosLightSpace = shadowMatrices[index] * vec4(fragPos, 1.0);
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     projCoords = projCoords * 0.5 + 0.5;
     // very important sanity checks THAT NOBODY TOLD ME ABOUT
     if (projCoords.z > 1.0 || projCoords.z < 0.0 || projCoords.x > 1.0 || projCoords.x < 0.0 || projCoords.y > 1.0 || projCoords.y < 0.0) {
+        return 0.0;
+    }
+
+    vec4 atlasRect = shadowRects[index];
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowAtlas, 0));
+    vec2 tileCoords = atlasRect.xy + projCoords.xy * atlasRect.zw;
+    // keep the samples within the tile of the light
+    vec2 tileMin = atlasRect.xy + texelSize * 0.5;
+    vec2 tileMax = atlasRect.xy + atlasRect.zw - texelSize * 0.5;
+    return FilterAtlas(tileCoords, projCoords.z - bias, tileMin, tileMax);
+}
+
+vec3 CalcLight(Light light)
+{
+    vec3 light_distance = light.position - fragPos;
+    float distance = length(light_distance);
+    // the clusters are coarse, so some of the lights fall short
+    if (distance >= light.range) {
         return vec3(0.0);
     }
+    vec3 lightDir = normalize(light_distance);
 
-    float currentDepth = projCoords.z;
-    float bias = max(0.01 * (1.0 - dot(normalize(fragPos - light.position), lightDir)), 0.05);
-    float shadow = texture(light.depthMap, projCoords.xy).r;
-    shadow = currentDepth - bias > shadow ? 1.0 : 0.0;
+    // Shadow calculation, lights without a shadow map shine everywhere
+    float lit = 1.0;
+    if (light.shadow >= 0) {
+        float bias = max(0.01 * (1.0 - dot(normalize(fragPos - light.position), lightDir)), 0.05);
+        lit = CalcShadow(light.shadow, bias);
+    }
 
     float attenuation = 1.0 / (1 + 0.09 * distance + 0.032 * distance * distance);
     attenuation *= max(0.0, 1.0 - distance / light.range); // Ensure light falls off to zero at the maximum range
 
-    return (1.0 - shadow) * (light.color) * attenuation;
+    return lit * (light.color) * attenuation;
+}
+
+vec3 CalcSun()
+{
+    // use the nearest cascade that covers the fragment
+    for (int i = 0; i < SHADOW_CASCADES; ++i) {
+        vec3 projCoords = (sun.cascades[i] * vec4(fragPos, 1.0)).xyz * 0.5 + 0.5;
+        if (any(lessThan(projCoords, vec3(0.0))) || any(greaterThan(projCoords, vec3(1.0)))) {
+            continue;
+        }
+        return FilterCascade(projCoords.xy, i, projCoords.z - 0.002) * sun.color;
+    }
+    return sun.color;
 }
 
 void main()
 {
     vec4 leafColor = texture(leafTexture, texCoord);
 
+#if ALPHA_TO_COVERAGE
+    // the coverage of the pixel follows the alpha, sharpened so that the
+    // edge of the leaf stays crisp, and without a discard the depth test can
+    // run before shading
+    leafColor.a = (leafColor.a - 0.5) / max(fwidth(leafColor.a), 0.0001) + 0.5;
+#else
     // Discard transparent fragments
     if (leafColor.a < 0.5)
         discard;
+#endif
 
     vec3 result = ambientLight;
-    for (int i = 0; i < numLights; ++i) {
-        result += CalcLight(lights[i]);
+    ivec2 cluster = GetCluster();
+    for (int i = 0; i < cluster.y; ++i) {
+        result += CalcLight(GetLight(cluster.x + i));
+    }
+    if (hasSun) {
+        result += CalcSun();
     }
 
     out_color = vec4(result * leafColor.rgb, leafColor.a);
@@ -5,8 +5,8 @@ precision highp float;
 layout(location = 0) in vec3 vertexPosition;
 layout(location = 1) in vec2 vertexTexCoord;
 layout(location = 2) in vec3 vertexNormal;
-layout(location = 3) in vec3 vertexTangent;
-layout(location = 4) in vec3 vertexBitangent;
+// the sign of the bitangent in w
+layout(location = 3) in vec4 vertexTangent;
 layout(location = 5) in vec3 offset;
 
 out vec2 texCoord;
@@ -17,9 +17,23 @@ out mat3 TBN;
 uniform mat4 model;
 uniform mat4 viewProjection;
 uniform vec3 viewPos;
+// when positive, the instances farther than cutoffDistance from cutoffCenter are left out
+uniform vec3 cutoffCenter;
+uniform float cutoffDistance;
+
+// the depth prepass relies on both passes computing the exact same depth
+invariant gl_Position;
 
 void main()
 {
+    if (cutoffDistance > 0.0 && distance(offset.xz, cutoffCenter.xz) > cutoffDistance) {
+        // all the vertices in the same spot, so nothing gets rasterized
+        gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+        texCoord = vertexTexCoord;
+        fragPos = offset;
+        TBN = mat3(1.0);
+        return;
+    }
     vec3 worldPosition = vertexPosition + offset;
     vec3 toCamera = normalize(viewPos - worldPosition);
     vec3 right = normalize(cross(vec3(0.0, 1.0, 0.0), toCamera));
@@ -40,8 +54,9 @@ void main()
     texCoord = vertexTexCoord;
     fragPos = (billboardPos + vec4(offset, 0.0)).xyz;
 
-    vec3 T = normalize(vec3(billboardMatrix * vec4(vertexTangent, 0.0)));
-    vec3 B = normalize(vec3(billboardMatrix * vec4(vertexBitangent, 0.0)));
+    vec3 bitangent = cross(vertexNormal, vertexTangent.xyz) * (vertexTangent.w < 0.0 ? -1.0 : 1.0);
+    vec3 T = normalize(vec3(billboardMatrix * vec4(vertexTangent.xyz, 0.0)));
+    vec3 B = normalize(vec3(billboardMatrix * vec4(bitangent, 0.0)));
     vec3 N = normalize(vec3(billboardMatrix * vec4(vertexNormal, 0.0)));
     TBN = mat3(T, B, N);
 }
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 410 core
+precision highp float;
+
+in vec2 texCoord;
+
+uniform sampler2D leafTexture;
+// set in the depth prepass, while the shadow passes still cut the leaves out
+uniform bool alphaToCoverage;
+
+out vec4 out_color;
+
+// only writes the depth of the leaves
+void main()
+{
+    float alpha = texture(leafTexture, texCoord).a;
+    if (alphaToCoverage) {
+        // sharpened like in leaves.frag, so that both passes cover the same
+        // samples
+        out_color = vec4(0.0, 0.0, 0.0, (alpha - 0.5) / max(fwidth(alpha), 0.0001) + 0.5);
+        return;
+    }
+    if (alpha < 0.5)
+        discard;
+    out_color = vec4(0.0);
+}
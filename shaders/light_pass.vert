@@ -7,6 +7,9 @@ layout(location = 1) in vec2 vertexTexCoord;
 uniform mat4 viewProjection;
 uniform mat4 model;
 
+// the depth prepass relies on both passes computing the exact same depth
+invariant gl_Position;
+
 void main()
 {
     gl_Position = viewProjection * model * vec4(vertexPosition, 1.0);
@@ -0,0 +1,13 @@
+#version 410 core
+precision highp float;
+
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec2 vertexTexCoord;	
+
+uniform mat4 model;
+
+void main()
+{
+    // the geometry shader projects the vertex for every light
+    gl_Position = model * vec4(vertexPosition, 1.0);
+}
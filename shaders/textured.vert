@@ -4,8 +4,8 @@ precision highp float;
 layout(location = 0) in vec3 vertexPosition;
 layout(location = 1) in vec2 vertexTexCoord;
 layout(location = 2) in vec3 vertexNormal;
-layout(location = 3) in vec3 vertexTangent;
-layout(location = 4) in vec3 vertexBitangent;
+// the sign of the bitangent in w
+layout(location = 3) in vec4 vertexTangent;
 
 out vec2 texCoord;
 out vec3 fragPos;
@@ -18,6 +18,9 @@ out mat3 TBN;
 uniform mat4 model;
 uniform mat4 viewProjection;
 
+// the depth prepass relies on both passes computing the exact same depth
+invariant gl_Position;
+
 void main()
 {
     // Transform the vertex position by the model and view-projection matrices
@@ -28,8 +31,9 @@ void main()
     fragPos = vec3(model * vec4(vertexPosition, 1.0));
 
     // Calculate the TBN matrix
-    vec3 T = normalize(vec3(model * vec4(vertexTangent, 0.0)));
-    vec3 B = normalize(vec3(model * vec4(vertexBitangent, 0.0)));
+    vec3 bitangent = cross(vertexNormal, vertexTangent.xyz) * (vertexTangent.w < 0.0 ? -1.0 : 1.0);
+    vec3 T = normalize(vec3(model * vec4(vertexTangent.xyz, 0.0)));
+    vec3 B = normalize(vec3(model * vec4(bitangent, 0.0)));
     vec3 N = normalize(vec3(model * vec4(vertexNormal, 0.0)));
     TBN = mat3(T, B, N);
 }
\ No newline at end of file
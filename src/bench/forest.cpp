@@ -0,0 +1,61 @@
+/*
+ Benchmark of the procedural geometry generation at startup, timing how long
+ the trees of the game scene and the chunks around the camera take to
+ generate. Nothing is uploaded, so no OpenGL context is needed.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "../objects/terrain.hpp"
+#include "../objects/tree.hpp"
+
+// as many trees as the game scene spawns
+#define FOREST_TREES 400
+#define ROUNDS 10
+
+/*!
+ @brief Reports the fastest and the median time of some rounds
+ @param name The name of the timed work
+ @param times The times of the rounds, in seconds
+*/
+static void report(const char *name, std::vector<double> times) {
+  std::sort(times.begin(), times.end());
+  std::cout << name << ": min " << times.front() * 1000.0 << " ms, median "
+            << times[times.size() / 2] * 1000.0 << " ms" << std::endl;
+}
+
+int main() {
+  std::srand(0);
+  std::vector<double> tree_times, chunk_times;
+  for (uint8_t round = 0; round < ROUNDS; round++) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < FOREST_TREES; i++) {
+      tree_model tree(glm::linearRand(MIN_SEGMENTS, MAX_SEGMENTS),
+                      SEGMENT_HEIGHT,
+                      glm::linearRand(MIN_BARK_RADIUS, MAX_BARK_RADIUS),
+                      BARK_VARIANCE, glm::linearRand(MIN_TIP_Y, MAX_TIP_Y));
+    }
+    std::chrono::duration<double> time =
+        std::chrono::steady_clock::now() - start;
+    tree_times.push_back(time.count());
+
+    // the chunks loaded around the camera, as a worker generates them
+    start = std::chrono::steady_clock::now();
+    for (int32_t x = -CHUNK_RADIUS; x <= CHUNK_RADIUS; x++) {
+      for (int32_t z = -CHUNK_RADIUS; z <= CHUNK_RADIUS; z++) {
+        glm::vec2 origin(x * CHUNK_SIZE, z * CHUNK_SIZE);
+        random_floor chunk(nullptr, nullptr, origin.x, 0.0, origin.y,
+                           CHUNK_SIZE, CHUNK_SIZE, CHUNK_RESOLUTION, origin);
+      }
+    }
+    time = std::chrono::steady_clock::now() - start;
+    chunk_times.push_back(time.count());
+  }
+  report("trees", tree_times);
+  report("chunks", chunk_times);
+  return 0;
+}
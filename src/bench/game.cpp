@@ -0,0 +1,155 @@
+/*
+ Headless benchmark of the game scene. The camera walks a scripted path for a
+ number of frames, rendered offscreen, and the per pass CPU and GPU timings
+ are printed as JSON, along with the average per frame statistics.
+
+ Usage: bench-game [frames] [trace]
+ If a trace path is given, the profiler trace of the measured frames is
+ written there as well.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../engine/utils/profiler.hpp"
+#include "../engine/utils/stats.hpp"
+#include "../scenes/game.hpp"
+
+#define BENCH_WIDTH 1280
+#define BENCH_HEIGHT 720
+#define BENCH_FRAMES 600
+// frames rendered before measuring, so that the terrain gets streamed in
+#define BENCH_WARMUP 60
+#define BENCH_SEED 1
+// fixed tick, so that every run walks the same path
+#define BENCH_TICK (1.0 / 60.0)
+// how fast the camera turns while walking forward, in radians per second
+#define BENCH_TURN_RATE 0.3f
+#define BENCH_NAME "Crawler bench"
+
+/*!
+ @brief Prints summary statistics of a series of timings as a JSON object
+ @param values The timings, in milliseconds
+*/
+static void print_stats(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  double sum = 0.0;
+  for (double value : values) {
+    sum += value;
+  }
+  std::cout << "{\"mean\": " << sum / values.size()
+            << ", \"min\": " << values.front()
+            << ", \"p50\": " << values[values.size() / 2]
+            << ", \"p95\": " << values[values.size() * 95 / 100]
+            << ", \"max\": " << values.back() << "}";
+}
+
+int main(int argc, char **argv) {
+  uint32_t frames = BENCH_FRAMES;
+  if (argc > 1) {
+    frames = std::max(std::atoi(argv[1]), 1);
+  }
+#ifdef GLFW_PLATFORM_NULL
+  // without a display we can still render through OSMesa (e.g. llvmpipe)
+  bool has_display =
+      std::getenv("DISPLAY") != NULL || std::getenv("WAYLAND_DISPLAY") != NULL;
+  if (!has_display) {
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+  }
+#endif
+  if (glfwInit() == GLFW_FALSE) {
+    const char *desc;
+    int code = glfwGetError(&desc);
+    std::cerr << "GLFW error: " << code << ", " << desc << std::endl;
+    return -1;
+  }
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef GLFW_PLATFORM_NULL
+  if (!has_display) {
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+  }
+#endif
+
+  std::srand(BENCH_SEED);
+
+  std::list<boid *> boids;
+  game game_scene(boids);
+  camera main_camera(glm::vec3(0.0f, 0.0f, 0.0f));
+  std::mutex mutex;
+  bool should_close = false;
+
+  std::map<std::string, std::vector<double>> results;
+  uint64_t counters[STAT_COUNT] = {};
+  {
+    renderer bench_renderer(BENCH_WIDTH, BENCH_HEIGHT, BENCH_NAME, &mutex,
+                            &main_camera, &game_scene, &should_close, NULL,
+                            true);
+    // the scripted path, walking forward while slowly turning
+    game_scene.key_callback(GLFW_KEY_W, 0, GLFW_PRESS, 0, main_camera);
+    double current_time = 0.0;
+    for (uint32_t frame = 0; frame < BENCH_WARMUP + frames; frame++) {
+      current_time += BENCH_TICK;
+      if (frame == BENCH_WARMUP) {
+        profiler::get().set_enabled(argc > 2);
+      }
+      main_camera.set_rotation(
+          glm::vec3(0.0f, current_time * BENCH_TURN_RATE, 0.0f));
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      game_scene.update(&main_camera, BENCH_TICK, current_time);
+      double update_cpu = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+      frame_timings timings;
+      bench_renderer.render_frame(&timings);
+      if (frame < BENCH_WARMUP) {
+        continue;
+      }
+      results["update.cpu"].push_back(update_cpu);
+      results["shadow.cpu"].push_back(timings.shadow_cpu);
+      results["shadow.gpu"].push_back(timings.shadow_gpu);
+      results["scene.cpu"].push_back(timings.scene_cpu);
+      results["scene.gpu"].push_back(timings.scene_gpu);
+      results["present.cpu"].push_back(timings.present_cpu);
+      frame_stats frame_counters = stats::get().get_last_frame(BENCH_NAME);
+      for (uint8_t i = 0; i < STAT_COUNT; i++) {
+        counters[i] += frame_counters.counters[i];
+      }
+    }
+  }
+
+  std::cout << "{\"frames\": " << frames << ", \"width\": " << BENCH_WIDTH
+            << ", \"height\": " << BENCH_HEIGHT << ", \"passes\": {";
+  std::string pass;
+  for (const auto &pair : results) {
+    size_t dot = pair.first.find('.');
+    std::string name = pair.first.substr(0, dot);
+    if (name != pass) {
+      std::cout << (pass.empty() ? "" : "}, ") << "\"" << name << "\": {";
+      pass = name;
+    } else {
+      std::cout << ", ";
+    }
+    std::cout << "\"" << pair.first.substr(dot + 1) << "\": ";
+    print_stats(pair.second);
+  }
+  std::cout << "}}, \"stats\": {";
+  for (uint8_t i = 0; i < STAT_COUNT; i++) {
+    std::cout << (i == 0 ? "" : ", ") << "\"" << stats::get_name((stat_counter)i)
+              << "\": " << (double)counters[i] / frames;
+  }
+  std::cout << "}}" << std::endl;
+  if (argc > 2) {
+    profiler::get().export_chrome_trace(argv[2]);
+  }
+
+  glfwTerminate();
+  return 0;
+}
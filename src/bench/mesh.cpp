@@ -0,0 +1,121 @@
+/*
+ Benchmark of the vertex cache optimization, comparing the number of vertices
+ transformed per triangle before and after reordering the triangles of a few
+ meshes, and timing the reordering.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../engine/utils/mesh_optimizer.hpp"
+
+#define GRID_SIZE 256
+#define RING_POINTS 16
+#define RING_COUNT 2048
+
+/*!
+ @brief Builds a grid of quads, row by row, like the terrain
+ @param size The number of vertices along a side
+ @return The indices of the grid
+*/
+static std::vector<unsigned int> make_grid(unsigned int size) {
+  std::vector<unsigned int> indices;
+  indices.reserve((size - 1) * (size - 1) * 6);
+  for (unsigned int z = 0; z < size - 1; z++) {
+    for (unsigned int x = 0; x < size - 1; x++) {
+      unsigned int corner = z * size + x;
+      indices.insert(indices.end(), {corner, corner + size, corner + 1,
+                                     corner + 1, corner + size,
+                                     corner + size + 1});
+    }
+  }
+  return indices;
+}
+
+/*!
+ @brief Builds a tube out of rings, like the bark of the trees, with every
+  side stitched from the bottom ring to the top one
+ @param points The number of vertices in a ring
+ @param rings The number of rings
+ @return The indices of the tube
+*/
+static std::vector<unsigned int> make_tube(unsigned int points,
+                                           unsigned int rings) {
+  std::vector<unsigned int> indices;
+  indices.reserve(points * (rings - 1) * 6);
+  for (unsigned int side = 0; side < points; side++) {
+    for (unsigned int ring = 0; ring < rings - 1; ring++) {
+      unsigned int a = ring * points + side;
+      unsigned int b = ring * points + (side + 1) % points;
+      indices.insert(indices.end(),
+                     {a, a + points, b, b, a + points, b + points});
+    }
+  }
+  return indices;
+}
+
+/*!
+ @brief Shuffles the triangles of a mesh, like an exporter that ignores the
+  cache might
+ @param indices The indices of the mesh
+ @return The shuffled indices
+*/
+static std::vector<unsigned int>
+shuffle_triangles(const std::vector<unsigned int> &indices) {
+  std::vector<size_t> order(indices.size() / 3);
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937(0));
+  std::vector<unsigned int> shuffled;
+  shuffled.reserve(indices.size());
+  for (size_t triangle : order) {
+    shuffled.insert(shuffled.end(), indices.begin() + triangle * 3,
+                    indices.begin() + triangle * 3 + 3);
+  }
+  return shuffled;
+}
+
+/*!
+ @brief Optimizes a mesh, and reports its cache miss ratios
+ @param name The name of the mesh
+ @param indices The indices of the mesh
+ @param vertex_count The number of vertices of the mesh
+*/
+static void measure(const std::string &name, std::vector<unsigned int> indices,
+                    size_t vertex_count) {
+  const uint32_t cache_sizes[] = {16, 32};
+  float before[2], after[2];
+  for (uint8_t i = 0; i < 2; i++) {
+    before[i] = get_acmr(indices, vertex_count, cache_sizes[i]);
+  }
+  auto start = std::chrono::steady_clock::now();
+  optimize_vertex_cache(indices, vertex_count);
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+  for (uint8_t i = 0; i < 2; i++) {
+    after[i] = get_acmr(indices, vertex_count, cache_sizes[i]);
+  }
+
+  std::cout << name << " (" << indices.size() / 3 << " triangles)"
+            << std::endl;
+  for (uint8_t i = 0; i < 2; i++) {
+    std::cout << "  ACMR, FIFO " << cache_sizes[i] << ": " << before[i]
+              << " -> " << after[i] << std::endl;
+  }
+  std::cout << "  optimized in " << time.count() * 1000.0 << " ms"
+            << std::endl;
+}
+
+int main() {
+  std::vector<unsigned int> grid = make_grid(GRID_SIZE);
+  std::vector<unsigned int> tube = make_tube(RING_POINTS, RING_COUNT);
+  measure("grid", grid, GRID_SIZE * GRID_SIZE);
+  measure("shuffled grid", shuffle_triangles(grid), GRID_SIZE * GRID_SIZE);
+  measure("tube", tube, RING_POINTS * RING_COUNT);
+  measure("shuffled tube", shuffle_triangles(tube), RING_POINTS * RING_COUNT);
+  return 0;
+}
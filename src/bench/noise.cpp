@@ -0,0 +1,52 @@
+/*
+ Microbenchmark of the noise functions, comparing the scalar noise() against
+ the batched noise_n(), and checking that they agree bit for bit.
+*/
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "../engine/utils/noise.hpp"
+
+#define SAMPLES (1 << 20)
+#define ROUNDS 16
+
+int main() {
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<float> distribution(-1000.f, 1000.f);
+  std::vector<float> xs(SAMPLES), ys(SAMPLES), scalar(SAMPLES), batched(SAMPLES);
+  for (size_t i = 0; i < SAMPLES; i++) {
+    xs[i] = distribution(generator);
+    ys[i] = distribution(generator);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint8_t round = 0; round < ROUNDS; round++) {
+    for (size_t i = 0; i < SAMPLES; i++) {
+      scalar[i] = noise(xs[i], ys[i]);
+    }
+  }
+  std::chrono::duration<double> scalar_time =
+      std::chrono::steady_clock::now() - start;
+
+  start = std::chrono::steady_clock::now();
+  for (uint8_t round = 0; round < ROUNDS; round++) {
+    noise_n(xs.data(), ys.data(), batched.data(), SAMPLES);
+  }
+  std::chrono::duration<double> batched_time =
+      std::chrono::steady_clock::now() - start;
+
+  double total = (double)SAMPLES * ROUNDS;
+  std::cout << "noise:   " << total / scalar_time.count() << " samples/s"
+            << std::endl;
+  std::cout << "noise_n: " << total / batched_time.count() << " samples/s"
+            << std::endl;
+  if (memcmp(scalar.data(), batched.data(), SAMPLES * sizeof(float)) != 0) {
+    std::cerr << "noise_n does not match noise" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "../renderable/object.hpp"
+
+/*!
+ @brief Where an entity is
+*/
+struct transform {
+  glm::vec3 position;
+};
+
+/*!
+ @brief The physical state of an entity moved by forces
+*/
+struct rigid_body {
+  float mass;
+  glm::vec3 velocity;
+  /*!
+   @brief The forces applied since the last integration
+  */
+  glm::vec3 force;
+};
+
+/*!
+ @brief The box around an entity, relative to its position
+*/
+struct bounding_box {
+  glm::vec3 low;
+  glm::vec3 high;
+};
+
+/*!
+ @brief The object drawing an entity in a scene
+ @details The object follows the transform of the entity, see sync_transforms
+*/
+struct render_link {
+  object *target;
+};
@@ -0,0 +1,49 @@
+#include "registry.hpp"
+
+#include <atomic>
+
+pool_base::~pool_base() {}
+
+size_t registry::next_type() {
+  static std::atomic<size_t> types(0);
+  return types++;
+}
+
+registry::registry() {}
+
+registry::~registry() {
+  for (pool_base *pool : pools) {
+    delete pool;
+  }
+}
+
+entity_id registry::create() {
+  entity_id entity;
+  if (free_indices.empty()) {
+    entity.index = generations.size();
+    generations.push_back(0);
+  } else {
+    entity.index = free_indices.back();
+    free_indices.pop_back();
+  }
+  entity.generation = generations[entity.index];
+  return entity;
+}
+
+void registry::destroy(entity_id entity) {
+  if (!is_alive(entity)) {
+    return;
+  }
+  for (pool_base *pool : pools) {
+    if (pool != nullptr) {
+      pool->remove(entity);
+    }
+  }
+  generations[entity.index]++;
+  free_indices.push_back(entity.index);
+}
+
+bool registry::is_alive(entity_id entity) const {
+  return entity.index < generations.size() &&
+         generations[entity.index] == entity.generation;
+}
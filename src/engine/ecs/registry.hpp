@@ -0,0 +1,237 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/*!
+ @brief Marks an entity without a component in a component_pool
+*/
+#define NO_COMPONENT UINT32_MAX
+
+/*!
+ @brief An entity of a registry
+ @details The generation tells apart the entities that reused the same index
+  over time, so an id of a destroyed entity never reaches its successor
+*/
+struct entity_id {
+  uint32_t index;
+  uint32_t generation;
+};
+
+/*!
+ @brief The type independent part of a component_pool
+*/
+class pool_base {
+public:
+  virtual ~pool_base();
+  /*!
+   @brief Removes the component of an entity, if it has one
+   @param entity The entity
+  */
+  virtual void remove(entity_id entity) = 0;
+};
+
+/*!
+ @brief The components of one type, of all the entities having one
+ @details A sparse set, the components are packed in a dense array, in no
+  particular order, alongside the entities they belong to. The sparse array
+  maps the index of every entity onto its component. Systems iterate over the
+  dense array directly, so they walk memory linearly.
+*/
+template <typename T> class component_pool : public pool_base {
+private:
+  /*!
+   @brief The position of the component of every entity, or NO_COMPONENT
+  */
+  std::vector<uint32_t> sparse;
+  std::vector<entity_id> entities;
+  std::vector<T> components;
+
+public:
+  /*!
+   @brief Adds a component to an entity, or replaces the one it has
+   @param entity The entity
+   @param component The component
+   @return The component in the pool
+  */
+  T &add(entity_id entity, const T &component);
+  void remove(entity_id entity) override;
+  /*!
+   @brief Gets the component of an entity
+   @param entity The entity
+   @return The component, or nullptr if the entity has none
+  */
+  T *get(entity_id entity);
+  /*!
+   @brief Gets the number of components in the pool
+   @return The number of components
+  */
+  size_t size() const;
+  /*!
+   @brief Gets a component by its position in the dense array
+   @param position The position, below size()
+   @return The component
+  */
+  T &at(size_t position);
+  /*!
+   @brief Gets the entity of a component by its position in the dense array
+   @param position The position, below size()
+   @return The entity
+  */
+  entity_id entity_at(size_t position) const;
+};
+
+/*!
+ @brief Creates entities and holds their components
+ @details Entities are just ids, anything they are made of lives in the
+  pools of components, one pool per component type, created on first use.
+  The registry isn't synchronized, so it should be modified by one thread.
+*/
+class registry {
+private:
+  /*!
+   @brief The current generation of every entity index
+  */
+  std::vector<uint32_t> generations;
+  /*!
+   @brief The indices of the destroyed entities, to be reused
+  */
+  std::vector<uint32_t> free_indices;
+  /*!
+   @brief The pools, by the index of their component type
+  */
+  std::vector<pool_base *> pools;
+  /*!
+   @brief Hands out the indices of the component types
+   @return The next unused index
+  */
+  static size_t next_type();
+  /*!
+   @brief Gets the index of a component type
+   @return The index, the same for every registry
+  */
+  template <typename T> static size_t type_index();
+
+public:
+  registry();
+  ~registry();
+  registry(const registry &) = delete;
+  registry &operator=(const registry &) = delete;
+  /*!
+   @brief Creates an entity without any components
+   @return The entity
+  */
+  entity_id create();
+  /*!
+   @brief Destroys an entity, along with all of its components
+   @param entity The entity
+  */
+  void destroy(entity_id entity);
+  /*!
+   @brief Checks if an entity hasn't been destroyed
+   @param entity The entity
+   @return True if the entity is alive
+  */
+  bool is_alive(entity_id entity) const;
+  /*!
+   @brief Gets the pool of a component type, creating it if necessary
+   @return The pool
+  */
+  template <typename T> component_pool<T> &pool();
+  /*!
+   @brief Adds a component to an entity
+   @param entity The entity
+   @param component The component
+   @return The component in its pool
+  */
+  template <typename T> T &add(entity_id entity, const T &component);
+  /*!
+   @brief Gets the component of an entity
+   @param entity The entity
+   @return The component, or nullptr if the entity has none
+  */
+  template <typename T> T *get(entity_id entity);
+};
+
+template <typename T>
+inline T &component_pool<T>::add(entity_id entity, const T &component) {
+  if (entity.index >= sparse.size()) {
+    sparse.resize(entity.index + 1, NO_COMPONENT);
+  }
+  uint32_t &position = sparse[entity.index];
+  if (position != NO_COMPONENT) {
+    entities[position] = entity;
+    components[position] = component;
+  } else {
+    position = components.size();
+    entities.push_back(entity);
+    components.push_back(component);
+  }
+  return components[position];
+}
+
+template <typename T>
+inline void component_pool<T>::remove(entity_id entity) {
+  if (get(entity) == nullptr) {
+    return;
+  }
+  // the last component fills the gap
+  uint32_t position = sparse[entity.index];
+  if (position != components.size() - 1) {
+    entities[position] = entities.back();
+    components[position] = std::move(components.back());
+    sparse[entities[position].index] = position;
+  }
+  sparse[entity.index] = NO_COMPONENT;
+  entities.pop_back();
+  components.pop_back();
+}
+
+template <typename T> inline T *component_pool<T>::get(entity_id entity) {
+  if (entity.index >= sparse.size() ||
+      sparse[entity.index] == NO_COMPONENT ||
+      entities[sparse[entity.index]].generation != entity.generation) {
+    return nullptr;
+  }
+  return &components[sparse[entity.index]];
+}
+
+template <typename T> inline size_t component_pool<T>::size() const {
+  return components.size();
+}
+
+template <typename T> inline T &component_pool<T>::at(size_t position) {
+  return components[position];
+}
+
+template <typename T>
+inline entity_id component_pool<T>::entity_at(size_t position) const {
+  return entities[position];
+}
+
+template <typename T> inline size_t registry::type_index() {
+  static const size_t index = next_type();
+  return index;
+}
+
+template <typename T> inline component_pool<T> &registry::pool() {
+  size_t index = type_index<T>();
+  if (index >= pools.size()) {
+    pools.resize(index + 1, nullptr);
+  }
+  if (pools[index] == nullptr) {
+    pools[index] = new component_pool<T>();
+  }
+  return *static_cast<component_pool<T> *>(pools[index]);
+}
+
+template <typename T>
+inline T &registry::add(entity_id entity, const T &component) {
+  return pool<T>().add(entity, component);
+}
+
+template <typename T> inline T *registry::get(entity_id entity) {
+  return pool<T>().get(entity);
+}
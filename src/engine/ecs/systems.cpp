@@ -0,0 +1,20 @@
+#include "systems.hpp"
+
+void integrate_bodies(registry &world, double delta_time) {
+  component_pool<rigid_body> &bodies = world.pool<rigid_body>();
+  for (size_t i = 0; i < bodies.size(); i++) {
+    rigid_body &body = bodies.at(i);
+    body.velocity += body.force / body.mass * (float)delta_time;
+    body.force = glm::vec3(0.0f);
+  }
+}
+
+void sync_transforms(registry &world) {
+  component_pool<render_link> &links = world.pool<render_link>();
+  for (size_t i = 0; i < links.size(); i++) {
+    const transform *place = world.get<transform>(links.entity_at(i));
+    if (place != nullptr) {
+      links.at(i).target->set_position(place->position);
+    }
+  }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "components.hpp"
+#include "registry.hpp"
+
+/*!
+ @brief Integrates the forces applied to the rigid bodies into their velocity
+ @param world The registry holding the bodies
+ @param delta_time The time since the last integration
+*/
+void integrate_bodies(registry &world, double delta_time);
+
+/*!
+ @brief Moves the objects drawing the entities to their transforms
+ @param world The registry holding the entities
+*/
+void sync_transforms(registry &world);
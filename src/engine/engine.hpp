@@ -6,14 +6,21 @@
 #include "gl/cubemap.hpp"
 #include "gl/renderer.hpp"
 #include "gl/shader.hpp"
+#include "gl/shadow_atlas.hpp"
 #include "gl/texture.hpp"
 // scene folder
 #include "scene/camera.hpp"
+#include "scene/directional_light.hpp"
 #include "scene/light.hpp"
 #include "scene/scene.hpp"
 // renderable folder
+#include "renderable/impostor_atlas.hpp"
 #include "renderable/object.hpp"
 #include "renderable/skybox.hpp"
+// ecs folder
+#include "ecs/components.hpp"
+#include "ecs/registry.hpp"
+#include "ecs/systems.hpp"
 
 #include "settings.hpp"
 
@@ -1,6 +1,7 @@
 #include "cubemap.hpp"
 
 #include "../utils/image_loader.hpp"
+#include "../utils/stats.hpp"
 #include "texture.hpp"
 
 #include <stdexcept>
@@ -39,6 +40,7 @@ cubemap::~cubemap() {}
 
 void cubemap::set_active_texture(const shader *target_shader, int texture_unit,
                                  std::string name) const {
+  stats::count(STAT_TEXTURE_BINDS);
   glActiveTexture(GL_TEXTURE0 + texture_unit);
   glBindTexture(GL_TEXTURE_CUBE_MAP, texture_id);
   target_shader->apply_uniform(texture_unit, name);
@@ -1,11 +1,14 @@
 
 #include "renderer.hpp"
 
+#include <chrono>
 #include <iostream>
 #include <stdexcept>
 #include <thread>
 
 #include "../utils/model_loader.hpp"
+#include "../utils/profiler.hpp"
+#include "../utils/stats.hpp"
 
 static const glm::vec3 loading_color = glm::vec3(038.0f, 206.0f, 0.0f);
 
@@ -145,11 +148,24 @@ renderer::renderer(int width, int height, const char *name, std::mutex *mutex,
 renderer::renderer(int width, int height, const char *name, std::mutex *mutex,
                    camera *render_camera, scene *target_scene,
                    bool *should_close, GLFWwindow *parent_window)
+    : renderer(width, height, name, mutex, render_camera, target_scene,
+               should_close, parent_window, false) {}
+
+renderer::renderer(int width, int height, const char *name, std::mutex *mutex,
+                   camera *render_camera, scene *target_scene,
+                   bool *should_close, GLFWwindow *parent_window,
+                   bool headless)
     : target_scene(nullptr), width(width), height(height), focused(false),
-      render_mutex(mutex), should_close(should_close) {
+      render_mutex(mutex), should_close(should_close), headless(headless),
+      framebuffer(0), color_buffer(0), depth_buffer(0), pass_queries{0, 0} {
   {
     std::lock_guard<std::mutex> lock(*mutex);
+    if (headless) {
+      glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    }
+    glfwWindowHint(GLFW_SAMPLES, target_scene->get_samples());
     this->window = glfwCreateWindow(width, height, name, NULL, parent_window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
     if (window == NULL) {
       const char *desc;
       glfwGetError(&desc);
@@ -161,9 +177,39 @@ renderer::renderer(int width, int height, const char *name, std::mutex *mutex,
     if (glewInit() != GLEW_OK) {
       throw std::runtime_error("Failed to initialize GLEW");
     }
+    if (headless) {
+      // the hidden window has no usable default framebuffer, so we make our
+      // own
+      glGenRenderbuffers(1, &color_buffer);
+      glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+      // multisampled like a window would be, so that it costs the same
+      glRenderbufferStorageMultisample(GL_RENDERBUFFER,
+                                       target_scene->get_samples(), GL_RGBA8,
+                                       width, height);
+      glGenRenderbuffers(1, &depth_buffer);
+      glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+      glRenderbufferStorageMultisample(GL_RENDERBUFFER,
+                                       target_scene->get_samples(),
+                                       GL_DEPTH24_STENCIL8, width, height);
+      glBindRenderbuffer(GL_RENDERBUFFER, 0);
+      glGenFramebuffers(1, &framebuffer);
+      glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                GL_RENDERBUFFER, color_buffer);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                                GL_RENDERBUFFER, depth_buffer);
+      if (glCheckFramebufferStatus(GL_FRAMEBUFFER) !=
+          GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("Failed to create offscreen framebuffer");
+      }
+    }
     glViewport(0, 0, width, height);
 
     glEnable(GL_DEPTH_TEST);
+#ifndef WASM
+    // always on in WebGL
+    glEnable(GL_MULTISAMPLE);
+#endif
 
     glClearColor(0.0, 0.0, 0.0, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -189,11 +235,22 @@ renderer::renderer(int width, int height, const char *name, std::mutex *mutex,
   glfwSetWindowCloseCallback(window, global_window_close_callback);
 #endif
 
+  profiler::get().name_thread(name);
   this->target_camera = render_camera;
   change_scene(target_scene);
 }
 
-renderer::~renderer() { glfwDestroyWindow(window); }
+renderer::~renderer() {
+  glfwMakeContextCurrent(window);
+  target_scene->deinit();
+  if (headless) {
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &color_buffer);
+    glDeleteRenderbuffers(1, &depth_buffer);
+  }
+  glfwMakeContextCurrent(NULL);
+  glfwDestroyWindow(window);
+}
 
 renderer renderer::clone(const char *name, scene *new_scene) {
   int width, height;
@@ -244,26 +301,98 @@ void renderer::run() {
 #endif
   while (!glfwWindowShouldClose(window) && !*should_close) {
     // render_mutex->lock();            // we wait for our turn to render
-    glfwMakeContextCurrent(window);  // tell openGL we are outputting to this
-    target_scene->shadow_pass();     // create shadow maps
-    glViewport(0, 0, width, height); // swap back to our resolution
-    // render the scene
-    target_scene->render(*target_camera, width, height);
-#ifndef WASM
-    glfwSwapBuffers(window);
-#endif
+    render_frame();
 #ifdef _WIN32
     glfwPollEvents();
 #endif
-    glfwMakeContextCurrent(NULL);
     // show the rendered scene
 #ifdef NO_THREADS
     double new_time = glfwGetTime();
     double delta_time = new_time - current_time;
     current_time = new_time;
-    target_scene->update(target_camera, delta_time, current_time);
+    {
+      profile_scope update_scope("update");
+      target_scene->update(target_camera, delta_time, current_time);
+    }
+#endif
+  }
+}
+
+static double elapsed_ms(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - since)
+      .count();
+}
+
+void renderer::render_frame(frame_timings *timings) {
+  glfwMakeContextCurrent(window); // tell openGL we are outputting to this
+  draw_frame(timings);
+  profiler::get().end_frame();
+  stats::get().end_frame();
+#ifndef WASM
+  if (timings != nullptr) {
+    // waits for the GPU to catch up
+    GLuint64 elapsed;
+    glGetQueryObjectui64v(pass_queries[0], GL_QUERY_RESULT, &elapsed);
+    timings->shadow_gpu = elapsed / 1e6;
+    glGetQueryObjectui64v(pass_queries[1], GL_QUERY_RESULT, &elapsed);
+    timings->scene_gpu = elapsed / 1e6;
+  }
+#endif
+  glfwMakeContextCurrent(NULL);
+}
+
+void renderer::draw_frame(frame_timings *timings) {
+  profile_scope frame_scope("frame", true);
+#ifndef WASM
+  if (timings != nullptr && pass_queries[0] == 0) {
+    glGenQueries(2, pass_queries);
+  }
 #endif
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+#ifndef WASM
+  if (timings != nullptr) {
+    glBeginQuery(GL_TIME_ELAPSED, pass_queries[0]);
+  }
+#endif
+  target_scene->apply_changes();
+  // create shadow maps
+  target_scene->shadow_pass(*target_camera, width, height);
+#ifndef WASM
+  if (timings != nullptr) {
+    glEndQuery(GL_TIME_ELAPSED);
+    timings->shadow_cpu = elapsed_ms(start);
+    start = std::chrono::steady_clock::now();
+    glBeginQuery(GL_TIME_ELAPSED, pass_queries[1]);
   }
+#endif
+  bind_target();                   // the shadow pass leaves it unbound
+  glViewport(0, 0, width, height); // swap back to our resolution
+  // render the scene
+  target_scene->render(*target_camera, width, height);
+#ifndef WASM
+  if (timings != nullptr) {
+    glEndQuery(GL_TIME_ELAPSED);
+    timings->scene_cpu = elapsed_ms(start);
+    start = std::chrono::steady_clock::now();
+  }
+#endif
+  profile_scope present_scope("present");
+  if (headless) {
+    glFlush();
+  } else {
+#ifndef WASM
+    glfwSwapBuffers(window);
+#endif
+  }
+  if (timings != nullptr) {
+    timings->present_cpu = elapsed_ms(start);
+  }
+}
+
+void renderer::bind_target() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 }
 
 void renderer::resize(int width, int height) {
@@ -299,9 +428,12 @@ void renderer::close_callback() {
 }
 
 void renderer::show_loading() {
+  bind_target();
   glClearColor(loading_color.r, loading_color.g, loading_color.b, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 #ifndef WASM
-  glfwSwapBuffers(window);
+  if (!headless) {
+    glfwSwapBuffers(window);
+  }
 #endif
 }
@@ -8,6 +8,15 @@
 
 #include <mutex>
 
+/*!
+ @brief How long the passes of a single frame took, in milliseconds
+*/
+struct frame_timings {
+  double shadow_cpu, shadow_gpu;
+  double scene_cpu, scene_gpu;
+  double present_cpu;
+};
+
 /*!
  @brief Renderer class to handle rendering of scenes.
  @details This class is used to render scenes and handle input.
@@ -22,6 +31,30 @@ private:
   std::mutex *render_mutex;
   void show_loading();
   bool *should_close;
+  /*!
+   @brief Whether we render into an offscreen framebuffer, with the window
+    hidden
+  */
+  bool headless;
+  ///@{
+  /*!
+   @brief The offscreen framebuffer and its attachments, used when headless
+  */
+  GLuint framebuffer, color_buffer, depth_buffer;
+  ///@}
+  /*!
+   @brief The timer queries of the shadow and scene passes
+  */
+  GLuint pass_queries[2];
+  /*!
+   @brief Binds the framebuffer we should be rendering into
+  */
+  void bind_target() const;
+  /*!
+   @brief Issues all the passes of a frame
+   @param timings Where to store the CPU timings, or nullptr
+  */
+  void draw_frame(frame_timings *timings);
 
 public:
   /*!
@@ -55,6 +88,24 @@ public:
   renderer(int width, int height, const char *name, std::mutex *mutex,
            camera *target_camera, scene *target_scene, bool *should_close,
            GLFWwindow *parent_window);
+  /*!
+   @brief Constructs a renderer, optionally rendering offscreen
+   @param width The width of the window
+   @param height The height of the window
+   @param name The name of the window
+   @param mutex The mutex to use for synchronization
+   @param target_camera The camera to use for rendering
+   @param target_scene The scene to render
+   @param should_close A reference to a boolean that is used to synchronize
+    the closing of the window
+   @param parent_window The parent window of the renderer
+   @param headless If true the window stays hidden, and the scene is rendered
+    into an offscreen framebuffer instead
+   @note This will create a window and initialize GLEW
+  */
+  renderer(int width, int height, const char *name, std::mutex *mutex,
+           camera *target_camera, scene *target_scene, bool *should_close,
+           GLFWwindow *parent_window, bool headless);
   ~renderer();
   /*!
    @brief Creates a new renderer based on this one, sharing the scene,
@@ -69,6 +120,14 @@ public:
    @warning This function will block until the window is closed
   */
   void run();
+  /*!
+   @brief Renders a single frame
+   @param timings If not nullptr, the passes of the frame get timed and the
+    results stored here
+   @warning Timing waits for the GPU to finish the frame, so it is only meant
+    for benchmarking
+  */
+  void render_frame(frame_timings *timings = nullptr);
   /*!
    @brief Change the scene to render
    @details This function will change the scene to render, and initialize the
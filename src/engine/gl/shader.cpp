@@ -1,9 +1,35 @@
 #include "shader.hpp"
 
+#include "../settings.hpp"
 #include "../utils/shader_loader.hpp"
+#include "../utils/stats.hpp"
 
 #include <stdexcept>
 
+#define STRINGIFY(x) #x
+#define TO_STRING(x) STRINGIFY(x)
+
+/*!
+ @brief Adds the engine settings the shaders depend on to a shader source
+ @param source The source of the shader
+ @return The source, with the defines following the version directive
+*/
+static std::string add_defines(const std::string &source) {
+  size_t line_end = source.find('\n', source.find("#version"));
+  if (line_end == std::string::npos) {
+    return source;
+  }
+  return source.substr(0, line_end + 1) +
+         "#define SHADOW_KERNEL " TO_STRING(SHADOW_KERNEL) "\n"
+         "#define ALPHA_TO_COVERAGE " TO_STRING(ALPHA_TO_COVERAGE) "\n"
+         "#define CLUSTER_X " TO_STRING(CLUSTER_X) "\n"
+         "#define CLUSTER_Y " TO_STRING(CLUSTER_Y) "\n"
+         "#define CLUSTER_Z " TO_STRING(CLUSTER_Z) "\n"
+         "#define CLUSTER_INDEX_WIDTH " TO_STRING(CLUSTER_INDEX_WIDTH) "\n"
+         "#define IMPOSTOR_VIEWS " TO_STRING(IMPOSTOR_VIEWS) "\n" +
+         source.substr(line_end + 1);
+}
+
 /*!
  @brief Compile a shader from a given source
  @param source The source of the shader
@@ -12,7 +38,8 @@
 */
 static GLuint compile_shader(const std::string &source, GLenum type) {
   GLuint shader = glCreateShader(type);
-  const char *src = source.c_str();
+  std::string full_source = add_defines(source);
+  const char *src = full_source.c_str();
   glShaderSource(shader, 1, &src, NULL);
   glCompileShader(shader);
 
@@ -34,14 +61,36 @@ shader::shader(const std::string vertex_path, const std::string fragment_Path,
     : shadow_simple(shadow_simple) {
   shader_loader &loader = shader_loader::get();
 
-  GLuint vertex_shader =
-      compile_shader(loader.load_shader(vertex_path), GL_VERTEX_SHADER);
-  GLuint fragment_shader =
-      compile_shader(loader.load_shader(fragment_Path), GL_FRAGMENT_SHADER);
+  GLuint shaders[2] = {
+      compile_shader(loader.load_shader(vertex_path), GL_VERTEX_SHADER),
+      compile_shader(loader.load_shader(fragment_Path), GL_FRAGMENT_SHADER)};
+  link(shaders, 2);
+}
 
+shader::shader(const std::string vertex_path, const std::string geometry_path,
+               const std::string fragment_path, bool shadow_simple)
+    : shadow_simple(shadow_simple) {
+#ifndef WASM
+  shader_loader &loader = shader_loader::get();
+
+  GLuint shaders[3] = {
+      compile_shader(loader.load_shader(vertex_path), GL_VERTEX_SHADER),
+      compile_shader(loader.load_shader(geometry_path), GL_GEOMETRY_SHADER),
+      compile_shader(loader.load_shader(fragment_path), GL_FRAGMENT_SHADER)};
+  link(shaders, 3);
+#else
+  (void)vertex_path;
+  (void)geometry_path;
+  (void)fragment_path;
+  throw std::runtime_error("Geometry shaders are not supported");
+#endif
+}
+
+void shader::link(const GLuint *shaders, size_t count) {
   program = glCreateProgram();
-  glAttachShader(program, vertex_shader);
-  glAttachShader(program, fragment_shader);
+  for (size_t i = 0; i < count; i++) {
+    glAttachShader(program, shaders[i]);
+  }
   glLinkProgram(program);
 
   GLint success;
@@ -54,36 +103,81 @@ shader::shader(const std::string vertex_path, const std::string fragment_Path,
     throw std::runtime_error(message);
   }
 
-  glDeleteShader(vertex_shader);
-  glDeleteShader(fragment_shader);
+  for (size_t i = 0; i < count; i++) {
+    glDeleteShader(shaders[i]);
+  }
 }
 
 shader::~shader() { glDeleteProgram(program); }
 
-void shader::use() const { glUseProgram(program); }
+void shader::use() const {
+  stats::count(STAT_SHADER_BINDS);
+  glUseProgram(program);
+}
 
 void shader::apply_uniform_mat4(glm::mat4 matrix,
                                 const std::string &name) const {
+  stats::count(STAT_UNIFORM_UPLOADS);
   glUniformMatrix4fv(glGetUniformLocation(program, name.c_str()), 1, GL_FALSE,
                      (float *)&matrix);
 }
 
+void shader::apply_uniform_mat4(const glm::mat4 *matrices, GLsizei count,
+                                const std::string &name) const {
+  stats::count(STAT_UNIFORM_UPLOADS);
+  glUniformMatrix4fv(glGetUniformLocation(program, name.c_str()), count,
+                     GL_FALSE, (const float *)matrices);
+}
+
 GLint shader::get_attrib_location(const std::string &name) const {
   return glGetAttribLocation(program, name.c_str());
 }
 
 void shader::apply_uniform(int value, const std::string &name) const {
+  stats::count(STAT_UNIFORM_UPLOADS);
   glUniform1i(glGetUniformLocation(program, name.c_str()), value);
 }
 
 void shader::apply_uniform_scalar(float scalar, const std::string &name) const {
+  stats::count(STAT_UNIFORM_UPLOADS);
   glUniform1f(glGetUniformLocation(program, name.c_str()), scalar);
 }
 
 void shader::apply_uniform_vec3(glm::vec3 vector,
                                 const std::string &name) const {
+  stats::count(STAT_UNIFORM_UPLOADS);
   glUniform3fv(glGetUniformLocation(program, name.c_str()), 1,
                (float *)&vector);
 }
 
+void shader::apply_uniform_vec4(glm::vec4 vector,
+                                const std::string &name) const {
+  stats::count(STAT_UNIFORM_UPLOADS);
+  glUniform4fv(glGetUniformLocation(program, name.c_str()), 1,
+               (float *)&vector);
+}
+
+void shader::apply_uniform_vec4(const glm::vec4 *vectors, GLsizei count,
+                                const std::string &name) const {
+  stats::count(STAT_UNIFORM_UPLOADS);
+  glUniform4fv(glGetUniformLocation(program, name.c_str()), count,
+               (const float *)vectors);
+}
+
 bool shader::is_shadow_simple() const { return shadow_simple; }
+
+void shader::set_opaque(bool opaque) { this->opaque = opaque; }
+
+bool shader::is_opaque() const { return opaque; }
+
+void shader::set_alpha_tested(bool alpha_tested) {
+  this->alpha_tested = alpha_tested;
+}
+
+bool shader::is_alpha_tested() const { return alpha_tested; }
+
+void shader::set_depth_shader(const shader *depth_shader) {
+  this->depth_shader = depth_shader;
+}
+
+const shader *shader::get_depth_shader() const { return depth_shader; }
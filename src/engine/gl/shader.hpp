@@ -12,6 +12,24 @@ class shader {
 private:
   GLuint program;
   bool shadow_simple = false;
+  /*!
+   @brief Whether every fragment the shader covers is written
+  */
+  bool opaque = false;
+  /*!
+   @brief Whether the shader cuts out the transparent parts of its textures
+  */
+  bool alpha_tested = false;
+  /*!
+   @brief A cheaper shader writing the same depth, used in the depth prepass
+  */
+  const shader *depth_shader = nullptr;
+  /*!
+   @brief Links the compiled shaders into the program, and deletes them
+   @param shaders The compiled shaders
+   @param count The number of shaders
+  */
+  void link(const GLuint *shaders, size_t count);
 
 public:
   /*!
@@ -22,6 +40,16 @@ public:
   */
   shader(const std::string vertex_path, const std::string fragment_path,
          bool shadow_simple = true);
+  /*!
+   @brief Constructs a shader with a geometry stage based on three paths
+   @param vertex_path Path to the vertex shader
+   @param geometry_path Path to the geometry shader
+   @param fragment_path Path to the fragment shader
+   @param shadow_simple Whether the shader can be simplified for shadow passes
+   @warning Geometry shaders are unavailable in WebGL
+  */
+  shader(const std::string vertex_path, const std::string geometry_path,
+         const std::string fragment_path, bool shadow_simple = true);
   ~shader();
   /*!
    @brief Use the shader program
@@ -36,6 +64,14 @@ public:
    @param name The name of the uniform variable in the shader program
   */
   void apply_uniform_mat4(glm::mat4 matrix, const std::string &name) const;
+  /*!
+   @brief Apply a uniform array of matrices to the shader program
+   @param matrices The matrices to apply
+   @param count The number of matrices
+   @param name The name of the uniform array in the shader program
+  */
+  void apply_uniform_mat4(const glm::mat4 *matrices, GLsizei count,
+                          const std::string &name) const;
   /*!
    @brief Get the location of an attribute in the shader program
    @param name The name of the attribute
@@ -60,9 +96,63 @@ public:
    @param name The name of the uniform variable
   */
   void apply_uniform_vec3(glm::vec3 vector, const std::string &name) const;
+  /*!
+   @brief Set a uniform 4 component vector in the shader program
+   @param vector The vector to set
+   @param name The name of the uniform variable
+  */
+  void apply_uniform_vec4(glm::vec4 vector, const std::string &name) const;
+  /*!
+   @brief Apply a uniform array of 4 component vectors to the shader program
+   @param vectors The vectors to apply
+   @param count The number of vectors
+   @param name The name of the uniform array in the shader program
+  */
+  void apply_uniform_vec4(const glm::vec4 *vectors, GLsizei count,
+                          const std::string &name) const;
   /*!
    @brief Check if the shadow shader can be used instead of this one
    @return True if the shader is simple
   */
   bool is_shadow_simple() const;
+  /*!
+   @brief Marks the shader as opaque, so that it never discards or blends
+   @details Opaque shaders that are also shadow simple are drawn in the depth
+    prepass, so their vertex shaders have to compute an invariant gl_Position
+    exactly like light_pass.vert does
+   @param opaque Whether the shader is opaque
+  */
+  void set_opaque(bool opaque);
+  /*!
+   @brief Check if the shader is opaque
+   @return True if the shader never discards or blends
+  */
+  bool is_opaque() const;
+  /*!
+   @brief Marks the shader as alpha tested
+   @details Objects of alpha tested shaders are drawn with alpha to coverage
+    if ALPHA_TO_COVERAGE is set, in which case the shader shouldn't discard
+   @param alpha_tested Whether the shader is alpha tested
+  */
+  void set_alpha_tested(bool alpha_tested);
+  /*!
+   @brief Check if the shader is alpha tested
+   @return True if the shader cuts out transparent texels
+  */
+  bool is_alpha_tested() const;
+  /*!
+   @brief Sets a cheaper shader, that only writes the same depth as this one
+   @details Used to draw the objects in the depth prepass, if this shader
+    isn't simply opaque, and in the shadow passes if it isn't shadow simple.
+    The vertex shaders of both have to compute an invariant gl_Position the
+    same way. The alphaToCoverage uniform tells it whether to write the
+    coverage as alpha, or to discard the transparent fragments.
+   @param depth_shader The depth shader, or nullptr
+  */
+  void set_depth_shader(const shader *depth_shader);
+  /*!
+   @brief Gets the shader that writes the depth of this one
+   @return The depth shader, or nullptr if there is none
+  */
+  const shader *get_depth_shader() const;
 };
@@ -0,0 +1,123 @@
+#include "shadow_atlas.hpp"
+
+#include "../settings.hpp"
+#include "../utils/stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+shadow_atlas::shadow_atlas()
+    : depth_map(0), columns(1), rows(1), tile_res(SHADOW_RES) {
+  glGenFramebuffers(1, &framebuffer);
+  allocate();
+}
+
+shadow_atlas::~shadow_atlas() {
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteTextures(1, &depth_map);
+}
+
+void shadow_atlas::allocate() {
+  if (depth_map != 0) {
+    glDeleteTextures(1, &depth_map);
+  }
+  glGenTextures(1, &depth_map);
+  glBindTexture(GL_TEXTURE_2D, depth_map);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, columns * tile_res,
+               rows * tile_res, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+  // sampled with hardware filtered depth compares
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE,
+                  GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  // the shaders keep the lookups within a tile
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  // attach the texture to the framebuffer
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                         depth_map, 0);
+#ifndef WASM
+  glDrawBuffer(GL_NONE);
+#endif
+  glReadBuffer(GL_NONE);
+
+#ifndef WASM
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    throw std::runtime_error("Framebuffer is not complete!");
+  }
+#endif
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool shadow_atlas::reserve(uint16_t tiles) {
+  if (tiles <= get_capacity()) {
+    return false;
+  }
+  columns = std::ceil(std::sqrt((float)tiles));
+  rows = (tiles + columns - 1) / columns;
+  tile_res = std::min(SHADOW_RES, SHADOW_ATLAS_MAX / columns);
+  allocate();
+  return true;
+}
+
+uint16_t shadow_atlas::get_capacity() const { return columns * rows; }
+
+glm::vec4 shadow_atlas::get_tile_rect(uint16_t tile) const {
+  return glm::vec4((float)(tile % columns) / columns,
+                   (float)(tile / columns) / rows, 1.f / columns, 1.f / rows);
+}
+
+void shadow_atlas::set_viewport(uint16_t tile) const {
+  glViewport((tile % columns) * tile_res, (tile / columns) * tile_res,
+             tile_res, tile_res);
+}
+
+void shadow_atlas::set_viewport(uint16_t tile, GLuint index) const {
+#ifndef WASM
+  glViewportIndexedf(index, (tile % columns) * tile_res,
+                     (tile / columns) * tile_res, tile_res, tile_res);
+#else
+  (void)index;
+  set_viewport(tile);
+#endif
+}
+
+void shadow_atlas::bind() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void shadow_atlas::clear() const {
+  bind();
+  glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void shadow_atlas::clear(uint16_t tile) const {
+  bind();
+  glEnable(GL_SCISSOR_TEST);
+  glScissor((tile % columns) * tile_res, (tile / columns) * tile_res, tile_res,
+            tile_res);
+  glClear(GL_DEPTH_BUFFER_BIT);
+  glDisable(GL_SCISSOR_TEST);
+}
+
+void shadow_atlas::copy(const shadow_atlas &source) const {
+  GLint width = columns * tile_res, height = rows * tile_res;
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, source.framebuffer);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+  glBlitFramebuffer(0, 0, width, height, 0, 0, width, height,
+                    GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+  bind();
+}
+
+void shadow_atlas::use(int texture_unit) const {
+  stats::count(STAT_TEXTURE_BINDS);
+  glActiveTexture(GL_TEXTURE0 + texture_unit);
+  glBindTexture(GL_TEXTURE_2D, depth_map);
+}
+
+GLuint shadow_atlas::get_texture() const { return depth_map; }
@@ -0,0 +1,93 @@
+
+#pragma once
+
+#include "../include.hpp"
+
+#include <stdint.h>
+
+/*!
+ @brief A single depth texture, split into tiles, that holds the shadow maps
+  of all the lights in a scene
+ @details Tiles are laid out in a grid of SHADOW_RES sized squares, as close to
+  square as possible. If the grid would exceed SHADOW_ATLAS_MAX, the tiles
+  shrink instead.
+*/
+class shadow_atlas {
+private:
+  GLuint framebuffer;
+  GLuint depth_map;
+  uint16_t columns, rows;
+  /*!
+   @brief The resolution of a single tile
+  */
+  uint16_t tile_res;
+  /*!
+   @brief (Re)allocates the depth texture for the current layout
+  */
+  void allocate();
+
+public:
+  /*!
+   @brief Constructs an atlas with a single tile
+   @warning Requires an OpenGL context to be current
+  */
+  shadow_atlas();
+  ~shadow_atlas();
+  /*!
+   @brief Makes sure the atlas has at least a given number of tiles
+   @param tiles The number of tiles needed
+   @return True if the depth texture was reallocated, losing its contents
+  */
+  bool reserve(uint16_t tiles);
+  /*!
+   @brief Gets the number of tiles in the atlas
+   @return The number of tiles
+  */
+  uint16_t get_capacity() const;
+  /*!
+   @brief Gets where a tile lies in the atlas
+   @param tile The index of the tile
+   @return The offset of the tile in xy and its size in zw, in texture
+    coordinates
+  */
+  glm::vec4 get_tile_rect(uint16_t tile) const;
+  /*!
+   @brief Sets the viewport to a tile
+   @param tile The index of the tile
+  */
+  void set_viewport(uint16_t tile) const;
+  /*!
+   @brief Sets one of the indexed viewports to a tile
+   @param tile The index of the tile
+   @param index The index of the viewport, as selected by gl_ViewportIndex
+  */
+  void set_viewport(uint16_t tile, GLuint index) const;
+  /*!
+   @brief Binds the framebuffer of the atlas
+  */
+  void bind() const;
+  /*!
+   @brief Binds the framebuffer of the atlas, and clears all the tiles
+  */
+  void clear() const;
+  /*!
+   @brief Binds the framebuffer of the atlas, and clears a single tile
+   @param tile The index of the tile
+  */
+  void clear(uint16_t tile) const;
+  /*!
+   @brief Copies the contents of another atlas into this one, and binds it
+   @param source The atlas to copy, with the same layout as this one
+  */
+  void copy(const shadow_atlas &source) const;
+  /*!
+   @brief Binds the depth texture to a texture unit
+   @param texture_unit The texture unit to use
+  */
+  void use(int texture_unit) const;
+  /*!
+   @brief Gets the depth texture
+   @return The id of the depth texture
+  */
+  GLuint get_texture() const;
+};
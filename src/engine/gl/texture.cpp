@@ -3,6 +3,8 @@
 
 #include <stdexcept>
 
+#include "../utils/stats.hpp"
+
 texture::texture(GLuint texture_id) : texture_id(texture_id) {}
 
 // by default flip the image, this is because SOIL loads the image upside down
@@ -29,6 +31,7 @@ texture::~texture() { glDeleteTextures(1, &texture_id); }
 
 void texture::set_active_texture(const shader *target_shader, int texture_unit,
                                  std::string name) const {
+  stats::count(STAT_TEXTURE_BINDS);
   glActiveTexture(GL_TEXTURE0 + texture_unit);
   glBindTexture(GL_TEXTURE_2D, texture_id);
   target_shader->apply_uniform(texture_unit, name);
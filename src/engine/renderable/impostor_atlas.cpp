@@ -0,0 +1,114 @@
+#include "impostor_atlas.hpp"
+
+#include "../settings.hpp"
+
+#include <cmath>
+#include <stdexcept>
+
+/*!
+ @brief Allocates the color texture of an atlas
+ @param variants The number of rows of the atlas
+ @return The texture
+*/
+static GLuint create_atlas_texture(uint8_t variants) {
+  GLuint texture_id;
+  glGenTextures(1, &texture_id);
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, IMPOSTOR_VIEWS * IMPOSTOR_RES,
+               variants * IMPOSTOR_RES, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture_id;
+}
+
+impostor_atlas::impostor_atlas(uint8_t variants, glm::vec3 low,
+                               glm::vec3 high)
+    : texture(create_atlas_texture(variants)), variants(variants), low(low),
+      high(high) {
+  glGenRenderbuffers(1, &depth_buffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24,
+                        IMPOSTOR_VIEWS * IMPOSTOR_RES, variants * IMPOSTOR_RES);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  GLint previous;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                         texture_id, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, depth_buffer);
+
+#ifndef WASM
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    throw std::runtime_error("Framebuffer is not complete!");
+  }
+#endif
+
+  // the empty parts of the tiles stay transparent
+  GLfloat clear_color[4];
+  glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+  glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glClearColor(clear_color[0], clear_color[1], clear_color[2],
+               clear_color[3]);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, previous);
+}
+
+impostor_atlas::~impostor_atlas() {
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteRenderbuffers(1, &depth_buffer);
+}
+
+void impostor_atlas::bake(
+    uint8_t variant, glm::vec3 origin,
+    const std::vector<std::pair<const shader *, const object *>> &parts) {
+  if (variant >= variants) {
+    throw std::runtime_error("Impostor variant out of range");
+  }
+  GLint viewport[4], previous;
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+  glm::vec3 frame = get_frame();
+  // far enough for the whole variant to be in front of the near plane
+  float distance = frame.x + 1.0f;
+  glm::mat4 projection = glm::ortho(-frame.x, frame.x, frame.y,
+                                    frame.y + frame.z, 0.0f, distance * 2.0f);
+  for (uint8_t view = 0; view < IMPOSTOR_VIEWS; view++) {
+    float angle = glm::radians(360.0f * view / IMPOSTOR_VIEWS);
+    glm::vec3 eye = origin + glm::vec3(sinf(angle), 0.0f, cosf(angle)) *
+                                 distance;
+    glm::mat4 view_projection = projection * glm::lookAt(eye, origin, UP);
+    glViewport(view * IMPOSTOR_RES, variant * IMPOSTOR_RES, IMPOSTOR_RES,
+               IMPOSTOR_RES);
+    for (const auto &part : parts) {
+      part.first->use();
+      part.first->apply_uniform_mat4(view_projection, "viewProjection");
+      part.first->apply_uniform_vec3(eye, "viewPos");
+      part.second->render(nullptr, part.first, 0);
+    }
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, previous);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  glBindTexture(GL_TEXTURE_2D, texture_id);
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+uint8_t impostor_atlas::get_variants() const { return variants; }
+
+glm::vec3 impostor_atlas::get_frame() const {
+  // the farthest any corner of the bounds gets from the vertical axis
+  glm::vec2 corner = glm::max(glm::abs(glm::vec2(low.x, low.z)),
+                              glm::abs(glm::vec2(high.x, high.z)));
+  return glm::vec3(glm::length(corner), low.y, high.y - low.y);
+}
@@ -0,0 +1,64 @@
+
+#pragma once
+
+#include "../gl/texture.hpp"
+#include "object.hpp"
+
+#include <utility>
+#include <vector>
+
+/*!
+ @brief A texture holding pictures of objects, to draw in their place when
+  they are far away
+ @details Every variant is baked from IMPOSTOR_VIEWS directions around the
+  vertical axis, into a row of IMPOSTOR_RES sized tiles, the first view
+  looking along the negative z axis. All the variants share the same frame, so
+  that a single billboard fits any of them. The color is baked unlit, with an
+  alpha of 1 where the objects cover the tile, and mipmapped.
+*/
+class impostor_atlas : public texture {
+private:
+  GLuint framebuffer, depth_buffer;
+  uint8_t variants;
+  ///@{
+  /*!
+   @brief The bounds of the variants, relative to their origin
+  */
+  glm::vec3 low, high;
+  ///@}
+
+public:
+  /*!
+   @brief Constructs an empty atlas
+   @param variants The number of variants the atlas holds
+   @param low The lower bounds of the variants, relative to their origin
+   @param high The upper bounds of the variants, relative to their origin
+   @warning Requires an OpenGL context to be current
+  */
+  impostor_atlas(uint8_t variants, glm::vec3 low, glm::vec3 high);
+  ~impostor_atlas();
+  /*!
+   @brief Bakes a variant from all the views
+   @details Every part is drawn with its shader, with the viewProjection and
+    viewPos uniforms set for each view, and without a camera, so at full
+    detail
+   @param variant The index of the variant
+   @param origin The position the bounds of the variant are relative to
+   @param parts The objects making up the variant, and their shaders
+   @warning Modifies the bound shader
+  */
+  void
+  bake(uint8_t variant, glm::vec3 origin,
+       const std::vector<std::pair<const shader *, const object *>> &parts);
+  /*!
+   @brief Gets the number of variants in the atlas
+   @return The number of variants
+  */
+  uint8_t get_variants() const;
+  /*!
+   @brief Gets the frame a billboard needs to show a variant in
+   @return The half width of the frame, and the height of its bottom and its
+    height, relative to the origin of the variant
+  */
+  glm::vec3 get_frame() const;
+};
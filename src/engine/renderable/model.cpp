@@ -6,15 +6,24 @@
 #include <assimp/scene.h>
 #endif
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <limits>
+#include <map>
+#include <queue>
 #include <stdexcept>
 #include <stdio.h>
+#include <tuple>
+
+#include "../settings.hpp"
+#include "../utils/mesh_optimizer.hpp"
+#include "../utils/stats.hpp"
 
 #define SHADER_VERTEX_POS 0
 #define SHADER_TEX_POS 1
 #define SHADER_NORMAL_POS 2
 #define SHADER_TANGENT_POS 3
-#define SHADER_BITANGENT_POS 4
 #define SHADER_INSTANCE_POS 5
 
 model::model(const std::vector<float> &data,
@@ -22,6 +31,11 @@ model::model(const std::vector<float> &data,
              glm::vec3 negbounds)
     : data(data), indices(indices), bounds(bounds), negbounds(negbounds) {}
 
+model::model(std::vector<float> &&data, std::vector<unsigned int> &&indices,
+             glm::vec3 bounds, glm::vec3 negbounds)
+    : data(std::move(data)), indices(std::move(indices)), bounds(bounds),
+      negbounds(negbounds) {}
+
 #ifndef STATIC_ASSETS
 model::model(const std::string &path, uint32_t mesh_index) {
   Assimp::Importer import;
@@ -113,86 +127,506 @@ model::~model() {}
 
 glm::vec3 model::get_bounds() const { return bounds; }
 
+// the upper triangle of a symmetric 4x4 matrix
+#define QUADRIC_SIZE 10
+
+/*!
+ @brief Adds the quadric of a plane to a quadric
+ @param quadric The quadric to add to
+ @param normal The normal of the plane
+ @param offset The offset of the plane, so that dot(normal, p) + offset = 0
+ @param weight The weight of the plane
+*/
+static void add_plane(double *quadric, glm::vec3 normal, float offset,
+                      float weight) {
+  double plane[4] = {normal.x, normal.y, normal.z, offset};
+  uint8_t i = 0;
+  for (uint8_t row = 0; row < 4; row++) {
+    for (uint8_t column = row; column < 4; column++) {
+      quadric[i++] += plane[row] * plane[column] * weight;
+    }
+  }
+}
+
+/*!
+ @brief Evaluates the sum of two quadrics at a point
+ @param a The first quadric
+ @param b The second quadric
+ @param point The point
+ @return The weighted sum of the squared distances to the planes
+*/
+static double get_error(const double *a, const double *b, glm::vec3 point) {
+  double vector[4] = {point.x, point.y, point.z, 1.0};
+  double error = 0.0;
+  uint8_t i = 0;
+  for (uint8_t row = 0; row < 4; row++) {
+    for (uint8_t column = row; column < 4; column++, i++) {
+      double product = (a[i] + b[i]) * vector[row] * vector[column];
+      error += row == column ? product : 2.0 * product;
+    }
+  }
+  return error;
+}
+
+/*!
+ @brief A possible edge collapse
+*/
+struct collapse {
+  double cost;
+  uint32_t from, to;
+  /*!
+   @brief The version of the removed vertex the collapse was found for
+  */
+  uint32_t version;
+  bool operator>(const collapse &other) const { return cost > other.cost; }
+};
+
+void model::generate_lods(uint8_t levels) {
+  size_t vertex_count = data.size() / MODEL_LINE_SIZE;
+  size_t triangle_count = indices.size() / 3;
+  auto position = [this](uint32_t vertex) {
+    return glm::vec3(data[vertex * MODEL_LINE_SIZE],
+                     data[vertex * MODEL_LINE_SIZE + 1],
+                     data[vertex * MODEL_LINE_SIZE + 2]);
+  };
+  std::vector<unsigned int> triangles(indices);
+  std::vector<bool> alive(triangle_count, true);
+  std::vector<std::vector<uint32_t>> adjacency(vertex_count);
+  std::vector<double> quadrics(vertex_count * QUADRIC_SIZE, 0.0);
+  std::map<std::pair<uint32_t, uint32_t>, uint32_t> edges;
+  for (uint32_t t = 0; t < triangle_count; t++) {
+    const unsigned int *corners = &triangles[t * 3];
+    glm::vec3 a = position(corners[0]);
+    glm::vec3 normal =
+        glm::cross(position(corners[1]) - a, position(corners[2]) - a);
+    float area = glm::length(normal);
+    for (uint8_t i = 0; i < 3; i++) {
+      adjacency[corners[i]].push_back(t);
+      if (area > 0.0f) {
+        add_plane(&quadrics[corners[i] * QUADRIC_SIZE], normal / area,
+                  -glm::dot(normal / area, a), area * 0.5f);
+      }
+      uint32_t from = corners[i], to = corners[(i + 1) % 3];
+      edges[std::make_pair(std::min(from, to), std::max(from, to))]++;
+    }
+  }
+  // moving the vertices of borders and seams would open up holes
+  std::vector<bool> locked(vertex_count, false);
+  for (const auto &edge : edges) {
+    if (edge.second == 1) {
+      locked[edge.first.first] = true;
+      locked[edge.first.second] = true;
+    }
+  }
+  std::map<std::tuple<float, float, float>, uint32_t> positions;
+  for (uint32_t v = 0; v < vertex_count; v++) {
+    glm::vec3 point = position(v);
+    auto key = std::make_tuple(point.x, point.y, point.z);
+    auto it = positions.find(key);
+    if (it != positions.end()) {
+      locked[v] = true;
+      locked[it->second] = true;
+    } else {
+      positions[key] = v;
+    }
+  }
+  std::vector<bool> removed(vertex_count, false);
+  std::vector<uint32_t> versions(vertex_count, 0);
+  std::priority_queue<collapse, std::vector<collapse>, std::greater<collapse>>
+      queue;
+  // the cheapest collapse of a vertex, that flips none of its triangles
+  auto push_collapse = [&](uint32_t from) {
+    if (locked[from] || removed[from]) {
+      return;
+    }
+    collapse best = {std::numeric_limits<double>::infinity(), from, from,
+                     versions[from]};
+    for (uint32_t t : adjacency[from]) {
+      if (!alive[t]) {
+        continue;
+      }
+      for (uint8_t i = 0; i < 3; i++) {
+        uint32_t to = triangles[t * 3 + i];
+        if (to == from) {
+          continue;
+        }
+        double cost = get_error(&quadrics[from * QUADRIC_SIZE],
+                                &quadrics[to * QUADRIC_SIZE], position(to));
+        if (cost >= best.cost) {
+          continue;
+        }
+        bool flips = false;
+        for (uint32_t other : adjacency[from]) {
+          const unsigned int *corners = &triangles[other * 3];
+          if (!alive[other] || corners[0] == to || corners[1] == to ||
+              corners[2] == to) {
+            continue;
+          }
+          glm::vec3 before[3], after[3];
+          for (uint8_t j = 0; j < 3; j++) {
+            before[j] = position(corners[j]);
+            after[j] = corners[j] == from ? position(to) : before[j];
+          }
+          glm::vec3 normal_before =
+              glm::cross(before[1] - before[0], before[2] - before[0]);
+          glm::vec3 normal_after =
+              glm::cross(after[1] - after[0], after[2] - after[0]);
+          if (glm::dot(normal_before, normal_after) <= 0.0f) {
+            flips = true;
+            break;
+          }
+        }
+        if (!flips) {
+          best.cost = cost;
+          best.to = to;
+        }
+      }
+    }
+    if (best.to != from) {
+      queue.push(best);
+    }
+  };
+  for (uint32_t v = 0; v < vertex_count; v++) {
+    push_collapse(v);
+  }
+  size_t alive_count = triangle_count;
+  std::vector<uint32_t> neighbours;
+  for (uint8_t level = 0; level < levels; level++) {
+    size_t previous = alive_count;
+    size_t target = alive_count * MODEL_LOD_RATIO;
+    while (alive_count > target && !queue.empty()) {
+      collapse next = queue.top();
+      queue.pop();
+      uint32_t from = next.from, to = next.to;
+      if (removed[from] || removed[to] || versions[from] != next.version) {
+        continue;
+      }
+      neighbours.clear();
+      for (uint32_t t : adjacency[from]) {
+        if (!alive[t]) {
+          continue;
+        }
+        unsigned int *corners = &triangles[t * 3];
+        if (corners[0] == to || corners[1] == to || corners[2] == to) {
+          alive[t] = false;
+          alive_count--;
+        } else {
+          std::replace(corners, corners + 3, (unsigned int)from,
+                       (unsigned int)to);
+          adjacency[to].push_back(t);
+        }
+        neighbours.insert(neighbours.end(), corners, corners + 3);
+      }
+      removed[from] = true;
+      for (uint8_t i = 0; i < QUADRIC_SIZE; i++) {
+        quadrics[to * QUADRIC_SIZE + i] += quadrics[from * QUADRIC_SIZE + i];
+      }
+      // the collapses around the kept vertex have to be found again
+      for (uint32_t t : adjacency[to]) {
+        if (alive[t]) {
+          neighbours.insert(neighbours.end(), &triangles[t * 3],
+                            &triangles[t * 3] + 3);
+        }
+      }
+      std::sort(neighbours.begin(), neighbours.end());
+      neighbours.erase(std::unique(neighbours.begin(), neighbours.end()),
+                       neighbours.end());
+      for (uint32_t v : neighbours) {
+        versions[v]++;
+        push_collapse(v);
+      }
+    }
+    if (alive_count == previous) {
+      break;
+    }
+    std::vector<unsigned int> level_indices;
+    level_indices.reserve(alive_count * 3);
+    for (uint32_t t = 0; t < triangle_count; t++) {
+      if (alive[t]) {
+        level_indices.insert(level_indices.end(), &triangles[t * 3],
+                             &triangles[t * 3] + 3);
+      }
+    }
+    lod_indices.push_back(level_indices);
+  }
+}
+
+uint8_t model::get_lod_count() const { return lod_buffers.size() + 1; }
+
+uint8_t model::select_lod(float screen_size) const {
+  uint8_t level = 0;
+  float threshold = MODEL_LOD_SCREEN_SIZE;
+  while (level < lod_buffers.size() && screen_size < threshold) {
+    level++;
+    threshold *= 0.5f;
+  }
+  return level;
+}
+
 glm::vec3 model::get_negbounds() const { return negbounds; }
 
+void model::optimize() {
+  size_t vertex_count = data.size() / MODEL_LINE_SIZE;
+  optimize_vertex_cache(indices, vertex_count);
+  for (auto &level : lod_indices) {
+    optimize_vertex_cache(level, vertex_count);
+  }
+  std::vector<unsigned int> remap = get_fetch_remap(indices, vertex_count);
+  std::vector<float> reordered(data.size());
+  for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+    std::copy(data.begin() + vertex * MODEL_LINE_SIZE,
+              data.begin() + (vertex + 1) * MODEL_LINE_SIZE,
+              reordered.begin() + remap[vertex] * MODEL_LINE_SIZE);
+  }
+  data.swap(reordered);
+  for (unsigned int &index : indices) {
+    index = remap[index];
+  }
+  for (auto &level : lod_indices) {
+    for (unsigned int &index : level) {
+      index = remap[index];
+    }
+  }
+}
+
+/*!
+ @brief Normalizes a vector, leaving zero vectors be
+ @param vector The vector
+ @return The unit vector, or the zero vector
+*/
+static glm::vec3 unit(glm::vec3 vector) {
+  float length = glm::length(vector);
+  return length > 0.0f ? vector / length : vector;
+}
+
+/*!
+ @brief Packs vertices into the layout uploaded to the GPU
+ @details The position stays a full float, followed by the texture
+  coordinates, as half floats if requested. The normal and the tangent are
+  packed into 10 bits per axis, and the remaining 2 bits of the tangent hold
+  the sign the bitangent is rebuilt with.
+ @param data The vertices, in the MODEL_LINE format
+ @param half_uvs Whether to store the texture coordinates as half floats
+ @param stride The size of a packed vertex
+ @return The packed vertices
+*/
+static std::vector<uint8_t> pack_vertices(const std::vector<float> &data,
+                                          bool half_uvs, size_t stride) {
+  size_t count = data.size() / MODEL_LINE_SIZE;
+  std::vector<uint8_t> packed(count * stride);
+  for (size_t i = 0; i < count; i++) {
+    const float *line = &data[i * MODEL_LINE_SIZE];
+    uint8_t *vertex = &packed[i * stride];
+    memcpy(vertex, line, 3 * sizeof(float));
+    vertex += 3 * sizeof(float);
+    if (half_uvs) {
+      uint16_t texel[2] = {glm::packHalf1x16(line[3]),
+                           glm::packHalf1x16(line[4])};
+      memcpy(vertex, texel, sizeof(texel));
+      vertex += sizeof(texel);
+    } else {
+      memcpy(vertex, line + 3, 2 * sizeof(float));
+      vertex += 2 * sizeof(float);
+    }
+    glm::vec3 normal(line[5], line[6], line[7]);
+    glm::vec3 tangent(line[8], line[9], line[10]);
+    glm::vec3 bitangent(line[11], line[12], line[13]);
+    float sign =
+        glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+    uint32_t axes[2] = {
+        glm::packSnorm3x10_1x2(glm::vec4(unit(normal), 0.0f)),
+        glm::packSnorm3x10_1x2(glm::vec4(unit(tangent), sign))};
+    memcpy(vertex, axes, sizeof(axes));
+  }
+  return packed;
+}
+
+/*!
+ @brief Gets the size of a packed vertex
+ @param half_uvs Whether the texture coordinates are half floats
+ @return The size in bytes
+*/
+static size_t get_stride(bool half_uvs) {
+  size_t texel_size = half_uvs ? 2 * sizeof(uint16_t) : 2 * sizeof(float);
+  return 3 * sizeof(float) + texel_size + 2 * sizeof(uint32_t);
+}
+
+/*!
+ @brief Uploads indices into the buffer bound to a target
+ @param target The target the buffer is bound to
+ @param indices The indices
+ @param type GL_UNSIGNED_SHORT to narrow the indices, or GL_UNSIGNED_INT
+*/
+static void upload_indices(GLenum target,
+                           const std::vector<unsigned int> &indices,
+                           GLenum type) {
+  if (type == GL_UNSIGNED_SHORT) {
+    std::vector<uint16_t> narrow(indices.begin(), indices.end());
+    glBufferData(target, sizeof(uint16_t) * narrow.size(), narrow.data(),
+                 GL_STATIC_DRAW);
+    stats::count(STAT_BUFFER_UPLOAD_BYTES, sizeof(uint16_t) * narrow.size());
+  } else {
+    glBufferData(target, sizeof(unsigned int) * indices.size(),
+                 indices.data(), GL_STATIC_DRAW);
+    stats::count(STAT_BUFFER_UPLOAD_BYTES,
+                 sizeof(unsigned int) * indices.size());
+  }
+}
+
 void model::init() {
   glGenVertexArrays(1, &VAO);
   glBindVertexArray(VAO);
 
+  // half floats are too coarse for texture coordinates tiling far
+  half_uvs = true;
+  for (size_t i = 0; i + MODEL_LINE_SIZE <= data.size();
+       i += MODEL_LINE_SIZE) {
+    if (std::abs(data[i + 3]) > MODEL_HALF_UV_RANGE ||
+        std::abs(data[i + 4]) > MODEL_HALF_UV_RANGE) {
+      half_uvs = false;
+      break;
+    }
+  }
+  std::vector<uint8_t> vertices =
+      pack_vertices(data, half_uvs, get_stride(half_uvs));
+
   glGenBuffers(1, &VBO);
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(float) * data.size(), data.data(),
+  glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.data(),
                GL_STATIC_DRAW);
+  stats::count(STAT_BUFFER_UPLOAD_BYTES, vertices.size());
+  // the largest index stays free, for primitive restart
+  index_type = data.size() / MODEL_LINE_SIZE < 0xFFFF ? GL_UNSIGNED_SHORT
+                                                      : GL_UNSIGNED_INT;
   glGenBuffers(1, &EBO);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(),
-               indices.data(), GL_STATIC_DRAW);
-
-  glVertexAttribPointer(SHADER_VERTEX_POS, 3, GL_FLOAT, GL_FALSE,
-                        MODEL_LINE_SIZE * sizeof(float), (void *)0);
-  glEnableVertexAttribArray(SHADER_VERTEX_POS);
-  glVertexAttribPointer(SHADER_TEX_POS, 2, GL_FLOAT, GL_FALSE,
-                        MODEL_LINE_SIZE * sizeof(float),
-                        (void *)(3 * sizeof(float)));
-  glEnableVertexAttribArray(SHADER_TEX_POS);
-  glVertexAttribPointer(SHADER_NORMAL_POS, 3, GL_FLOAT, GL_FALSE,
-                        MODEL_LINE_SIZE * sizeof(float),
-                        (void *)(5 * sizeof(float)));
-  glEnableVertexAttribArray(SHADER_NORMAL_POS);
-  glVertexAttribPointer(SHADER_TANGENT_POS, 3, GL_FLOAT, GL_FALSE,
-                        MODEL_LINE_SIZE * sizeof(float),
-                        (void *)(8 * sizeof(float)));
-  glEnableVertexAttribArray(SHADER_TANGENT_POS);
-  glVertexAttribPointer(SHADER_BITANGENT_POS, 3, GL_FLOAT, GL_FALSE,
-                        MODEL_LINE_SIZE * sizeof(float),
-                        (void *)(11 * sizeof(float)));
-  glEnableVertexAttribArray(SHADER_BITANGENT_POS);
+  upload_indices(GL_ELEMENT_ARRAY_BUFFER, indices, index_type);
+  index_count = indices.size();
+  set_attributes();
 
   glBindVertexArray(0);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
   glEnableVertexAttribArray(0);
+
+  // the element array binding belongs to the VAO, so the detail levels are
+  // uploaded through a binding point with no such side effects
+  lod_buffers.resize(lod_indices.size());
+  lod_counts.resize(lod_indices.size());
+  if (!lod_buffers.empty()) {
+    glGenBuffers(lod_buffers.size(), lod_buffers.data());
+  }
+  for (size_t i = 0; i < lod_indices.size(); i++) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, lod_buffers[i]);
+    upload_indices(GL_COPY_WRITE_BUFFER, lod_indices[i], index_type);
+    lod_counts[i] = lod_indices[i].size();
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void model::set_attributes() const {
+  size_t stride = get_stride(half_uvs);
+  size_t offset = 0;
+  glVertexAttribPointer(SHADER_VERTEX_POS, 3, GL_FLOAT, GL_FALSE, stride,
+                        (void *)offset);
+  glEnableVertexAttribArray(SHADER_VERTEX_POS);
+  offset += 3 * sizeof(float);
+  glVertexAttribPointer(SHADER_TEX_POS, 2, half_uvs ? GL_HALF_FLOAT : GL_FLOAT,
+                        GL_FALSE, stride, (void *)offset);
+  glEnableVertexAttribArray(SHADER_TEX_POS);
+  offset += half_uvs ? 2 * sizeof(uint16_t) : 2 * sizeof(float);
+  glVertexAttribPointer(SHADER_NORMAL_POS, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+                        stride, (void *)offset);
+  glEnableVertexAttribArray(SHADER_NORMAL_POS);
+  offset += sizeof(uint32_t);
+  glVertexAttribPointer(SHADER_TANGENT_POS, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+                        stride, (void *)offset);
+  glEnableVertexAttribArray(SHADER_TANGENT_POS);
 }
 
 void model::deinit() const {
   glDeleteVertexArrays(1, &VAO);
   glDeleteBuffers(1, &VBO);
   glDeleteBuffers(1, &EBO);
+  if (!lod_buffers.empty()) {
+    glDeleteBuffers(lod_buffers.size(), lod_buffers.data());
+  }
+}
+
+void model::release_data() {
+  // swapping with empty vectors actually frees the memory, unlike clear()
+  std::vector<float>().swap(data);
+  std::vector<unsigned int>().swap(indices);
+  std::vector<std::vector<unsigned int>>().swap(lod_indices);
 }
 
 void model::draw() const {
+  stats::count(STAT_DRAW_CALLS);
+  stats::count(STAT_TRIANGLES, index_count / 3);
+  stats::count(STAT_INSTANCES);
   glBindVertexArray(VAO);
-  glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, NULL);
+  glDrawElements(GL_TRIANGLES, index_count, index_type, NULL);
   glBindVertexArray(0);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
+void model::draw_lod(uint8_t level) const {
+  if (level == 0 || level > lod_buffers.size()) {
+    draw();
+  } else {
+    draw_indices(lod_buffers[level - 1], lod_counts[level - 1], index_type);
+  }
+}
+
+void model::draw_indices(GLuint index_buffer, GLsizei count, GLenum type,
+                         GLenum mode) const {
+  stats::count(STAT_DRAW_CALLS);
+  // long strips make about a triangle per index
+  stats::count(STAT_TRIANGLES, mode == GL_TRIANGLES ? count / 3 : count);
+  stats::count(STAT_INSTANCES);
+  glBindVertexArray(VAO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+  glDrawElements(mode, count, type, NULL);
+  // the element buffer binding is a part of the VAO state, so we restore it
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  glBindVertexArray(0);
+}
+
 instanced_model *
 model::get_instanced(const std::vector<glm::vec3> &instances) const {
-  instanced_model *instanced =
-      new instanced_model(data, indices, bounds, negbounds, instances);
+  instanced_model *instanced = new instanced_model(*this, instances);
   instanced->init();
   return instanced;
 }
 
-instanced_model::instanced_model(const std::vector<float> &data,
-                                 const std::vector<unsigned int> &indices,
-                                 glm::vec3 bounds, glm::vec3 negbounds,
+instanced_model::instanced_model(const model &source,
                                  const std::vector<glm::vec3> &instances)
-    : model(data, indices, bounds, negbounds), instances(instances) {}
+    : instances(instances) {
+  bounds = source.bounds;
+  negbounds = source.negbounds;
+  VBO = source.VBO;
+  EBO = source.EBO;
+  index_type = source.index_type;
+  index_count = source.index_count;
+  half_uvs = source.half_uvs;
+}
 
 instanced_model::~instanced_model() {}
 
 void instanced_model::init() {
-  model::init();
-
+  // only the VAO is our own, the buffers belong to the source model
+  glGenVertexArrays(1, &VAO);
   glBindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  set_attributes();
 
   glGenBuffers(1, &instanceVBO);
   glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
   glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * instances.size(),
                instances.data(), GL_STATIC_DRAW);
+  stats::count(STAT_BUFFER_UPLOAD_BYTES, sizeof(glm::vec3) * instances.size());
 
   glVertexAttribPointer(SHADER_INSTANCE_POS, 3, GL_FLOAT, GL_FALSE,
                         3 * sizeof(float), (void *)0);
@@ -204,13 +638,16 @@ void instanced_model::init() {
 }
 
 void instanced_model::deinit() const {
-  model::deinit();
+  glDeleteVertexArrays(1, &VAO);
   glDeleteBuffers(1, &instanceVBO);
 }
 
 void instanced_model::draw() const {
+  stats::count(STAT_DRAW_CALLS);
+  stats::count(STAT_TRIANGLES, index_count / 3 * instances.size());
+  stats::count(STAT_INSTANCES, instances.size());
   glBindVertexArray(VAO);
-  glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, NULL,
+  glDrawElementsInstanced(GL_TRIANGLES, index_count, index_type, NULL,
                           instances.size());
   glBindVertexArray(0);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -16,6 +16,8 @@ class instanced_model;
  @brief A collection of OpenGL entities necessary for things to get drawn
 */
 class model {
+  friend class instanced_model;
+
 protected:
   /*!
    @brief Hidden constructor creating an empty model
@@ -29,6 +31,19 @@ protected:
    @brief the indices of the object
   */
   std::vector<unsigned int> indices;
+  /*!
+   @brief The indices of the lower detail levels, the coarsest last
+   @details All the levels draw from the vertices of the full detail one
+  */
+  std::vector<std::vector<unsigned int>> lod_indices;
+  /*!
+   @brief The index buffers of the lower detail levels
+  */
+  std::vector<GLuint> lod_buffers;
+  /*!
+   @brief The number of indices in each of the lod_buffers
+  */
+  std::vector<GLsizei> lod_counts;
   ///@{
   /*!
    @brief The bounds of the object
@@ -41,6 +56,24 @@ protected:
   */
   GLuint VAO, VBO, EBO;
   ///@}
+  /*!
+   @brief The type of the uploaded indices, GL_UNSIGNED_SHORT if the vertices
+    allow for it
+  */
+  GLenum index_type;
+  /*!
+   @brief The number of uploaded indices of the full detail level
+  */
+  GLsizei index_count;
+  /*!
+   @brief Whether the texture coordinates were uploaded as half floats
+  */
+  bool half_uvs;
+  /*!
+   @brief Sets up the vertex attributes of the bound VAO, reading from the
+    bound array buffer
+  */
+  void set_attributes() const;
 
 public:
   /*!
@@ -53,6 +86,15 @@ public:
   model(const std::vector<float> &data,
         const std::vector<unsigned int> &indices, glm::vec3 bounds,
         glm::vec3 negbounds);
+  /*!
+   @brief Create a new model taking over the provided data
+   @param data the data to use. Assumed to match MODEL_LINE format
+   @param indices the indices pointing into the data
+   @param bounds the upper bounds for the model
+   @param negbounds the lower bounds for the model
+  */
+  model(std::vector<float> &&data, std::vector<unsigned int> &&indices,
+        glm::vec3 bounds, glm::vec3 negbounds);
 #ifndef STATIC_ASSETS
   /*!
    @brief Create a new model using the obj model at the provided path
@@ -61,15 +103,29 @@ public:
   */
   model(const std::string &path, uint32_t mesh_index = 0);
 #endif
-  ~model();
+  virtual ~model();
   /*!
    @brief Initializes the model within the OpenGL context
+   @details The vertices are uploaded in a packed layout of 24 bytes, rather
+    than the 56 of MODEL_LINE. Normals and tangents take 10 bits per axis,
+    and the bitangent is rebuilt in the shaders from them and a sign.
+    Texture coordinates are stored as half floats, unless any of them exceeds
+    MODEL_HALF_UV_RANGE, in which case they stay full floats.
   */
   virtual void init();
   /*!
    @brief Undoes the OpenGL initialization
   */
   virtual void deinit() const;
+  /*!
+   @brief Frees the copy of the vertices and indices kept on the CPU
+   @details Once uploaded the model draws from the GPU buffers alone, so the
+    copy is only needed to initialize the model again, or to process it
+    further
+   @warning Has to be called after init(), and the model can't be
+    initialized, simplified or optimized afterwards
+  */
+  void release_data();
   /*!
    @brief Gets the upper model bounds
    @return The upper model bounds
@@ -84,14 +140,66 @@ public:
    @brief Draws the model onto the viewport
   */
   virtual void draw() const;
+  /*!
+   @brief Builds lower detail levels through quadric simplification
+   @details Each level keeps about MODEL_LOD_RATIO of the triangles of the
+    previous one. Edges are collapsed onto one of their vertices, cheapest
+    first, by the squared distance to the planes of the triangles around the
+    removed vertex, so that all the levels share the vertex buffer. Vertices
+    on borders and texture seams are never removed, and collapses that
+    would flip a triangle are skipped.
+   @param levels The number of levels to build, fewer are built if the mesh
+    can't be simplified further
+   @warning Has to be called before init()
+  */
+  void generate_lods(uint8_t levels);
+  /*!
+   @brief Reorders the model for the vertex caches of the GPU
+   @details The triangles of every detail level are reordered so that
+    consecutive triangles share vertices, see optimize_vertex_cache, and the
+    vertices are then sorted by their first use in the full detail level
+   @warning Has to be called after generate_lods, and before init()
+  */
+  void optimize();
+  /*!
+   @brief Gets the number of detail levels of the initialized model
+   @return The number of levels, 1 if there is only the full detail one
+  */
+  uint8_t get_lod_count() const;
+  /*!
+   @brief Picks the detail level to draw the model at
+   @param screen_size The radius of the bounding sphere of the model on the
+    screen, as a fraction of half of the screen height
+   @return The level, 0 being the full detail
+  */
+  uint8_t select_lod(float screen_size) const;
+  /*!
+   @brief Draws the model at a given detail level
+   @param level The level, as returned by select_lod
+  */
+  void draw_lod(uint8_t level) const;
+  /*!
+   @brief Draws the model using an external index buffer
+   @details Useful for models sharing the same vertex layout, where a single
+    index buffer can serve all of them
+   @param index_buffer The index buffer to draw with
+   @param count The number of indices in the buffer
+   @param type The type of the indices in the buffer
+   @param mode The primitives the indices make up
+  */
+  void draw_indices(GLuint index_buffer, GLsizei count,
+                    GLenum type = GL_UNSIGNED_INT,
+                    GLenum mode = GL_TRIANGLES) const;
   /*!
    @brief Get an instanced version of the model
    @details In our model handling system, we have no place for instanced models
     so we have to create them on the fly. This is potentially a problem, yet
     not now. This method creates an instanced model based on the provided
-    instances and initializes it.
+    instances and initializes it. The instanced model draws from the vertex
+    and index buffers of this one, so it has to outlive it.
    @param instances the locations of the instances
    @return The instanced model
+   @warning Has to be called after init()
   */
   instanced_model *get_instanced(const std::vector<glm::vec3> &instances) const;
 };
@@ -110,18 +218,13 @@ private:
 
 public:
   /*!
-   @brief Create a new instanced model based on provided data
-   @param data the data to use. Assumed to match MODEL_LINE format
-   @param indices the indices pointing into the data
-   @param bounds the upper bounds for the model
-   @param negbounds the lower bounds for the model
+   @brief Create a new instanced model sharing the buffers of a model
+   @param source the initialized model to draw the instances of
    @param instances the locations of the instances
    @note You should probably not use this constructor and instead use the
      get_instanced method of the model class
   */
-  instanced_model(const std::vector<float> &data,
-                  const std::vector<unsigned int> &indices, glm::vec3 bounds,
-                  glm::vec3 negbounds, const std::vector<glm::vec3> &instances);
+  instanced_model(const model &source, const std::vector<glm::vec3> &instances);
   ~instanced_model();
   void init() override;
   void deinit() const override;
@@ -10,7 +10,8 @@
 
 object::object(const model *object_model, double xpos, double ypos, double zpos)
     : scale(glm::vec3(1.)), rot(glm::vec3(0.)), object_model(object_model),
-      position(xpos, ypos, zpos), active(true) {}
+      position(xpos, ypos, zpos), active(true), static_caster(false),
+      visible(true), shown(true) {}
 
 object::~object() {
   for (object *parent : parents) {
@@ -26,9 +27,22 @@ glm::mat4 object::get_model_matrix() const {
          glm::scale(glm::mat4(1.0f), scale);
 }
 
-void object::render(const camera *, const shader *current_shader,
+void object::render(const camera *target_camera, const shader *current_shader,
                     uint32_t tex_off) const {
+  render_level(current_shader, tex_off, get_lod(target_camera));
+}
+
+void object::render_shadow(const shader *current_shader,
+                           uint32_t tex_off) const {
+  render_level(current_shader, tex_off,
+               object_model == nullptr ? 0
+                                       : object_model->get_lod_count() - 1);
+}
 
+void object::begin_frame() const { shown = visible; }
+
+void object::render_level(const shader *current_shader, uint32_t tex_off,
+                          uint8_t level) const {
   size_t tex_i = tex_off;
   for (const auto &pair : textures) {
     pair.second->set_active_texture(current_shader, tex_i, pair.first);
@@ -37,7 +51,11 @@ void object::render(const camera *, const shader *current_shader,
 
   current_shader->apply_uniform_mat4(get_model_matrix(), "model");
 
-  this->draw();
+  if (level == 0) {
+    this->draw();
+  } else {
+    object_model->draw_lod(level);
+  }
 
   // unbind textures
   for (size_t i = tex_off; i < tex_i; i++) {
@@ -48,6 +66,22 @@ void object::render(const camera *, const shader *current_shader,
 
 void object::draw() const { object_model->draw(); }
 
+uint8_t object::get_lod(const camera *target_camera) const {
+  glm::vec3 low, high;
+  if (target_camera == nullptr || object_model == nullptr ||
+      object_model->get_lod_count() == 1 || !get_world_bounds(low, high)) {
+    return 0;
+  }
+  float radius = glm::length(high - low) * 0.5f;
+  float distance =
+      glm::distance(target_camera->get_position(), (low + high) * 0.5f);
+  if (distance <= radius) {
+    return 0;
+  }
+  float half_height = tanf(glm::radians(target_camera->get_fov()) * 0.5f);
+  return object_model->select_lod(radius / (distance * half_height));
+}
+
 void object::add_texture(const texture *tex, std::string name) {
   textures[name] = tex;
 }
@@ -127,3 +161,37 @@ bool object::check_line(glm::vec3 a, glm::vec3 b) const {
 bool object::is_active() const { return active; }
 
 void object::set_active(bool active) { this->active = active; }
+
+bool object::is_visible() const { return shown; }
+
+void object::set_visible(bool visible) { this->visible = visible; }
+
+bool object::is_static() const { return static_caster; }
+
+void object::set_static(bool static_caster) {
+  this->static_caster = static_caster;
+}
+
+bool object::get_world_bounds(glm::vec3 &low, glm::vec3 &high) const {
+  if (object_model == nullptr) {
+    return false;
+  }
+  glm::mat4 model = get_model_matrix();
+  glm::vec3 model_low = object_model->get_negbounds();
+  glm::vec3 model_high = object_model->get_bounds();
+  low = glm::vec3(std::numeric_limits<float>::infinity());
+  high = -low;
+  for (uint8_t i = 0; i < 8; i++) {
+    glm::vec3 corner =
+        model * glm::vec4(i & 1 ? model_high.x : model_low.x,
+                          i & 2 ? model_high.y : model_low.y,
+                          i & 4 ? model_high.z : model_low.z, 1.0f);
+    low = glm::min(low, corner);
+    high = glm::max(high, corner);
+  }
+  return true;
+}
+
+uint32_t object::get_revision() const { return 0; }
+
+void object::draw_occluders(occlusion_buffer &) const {}
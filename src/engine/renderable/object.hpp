@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
 #include <unordered_map>
 #include <vector>
@@ -11,6 +12,7 @@
 #include "../gl/texture.hpp"
 #include "../scene/camera.hpp"
 #include "../scene/light.hpp"
+#include "../scene/occlusion_buffer.hpp"
 #include "model.hpp"
 
 /*!
@@ -68,6 +70,26 @@ protected:
    @brief Whether this object is active
    */
   bool active;
+  /*!
+   @brief Whether this object never moves
+  */
+  bool static_caster;
+  /*!
+   @brief Whether the camera should draw this object, as set by any thread
+  */
+  std::atomic<bool> visible;
+  /*!
+   @brief Whether the camera draws this object in the current frame
+  */
+  mutable bool shown;
+  /*!
+   @brief Renders the model of the object at a given detail level
+   @param current_shader The shader to render the object with
+   @param tex_off The offset to start the textures at
+   @param level The detail level, 0 being the full detail
+  */
+  void render_level(const shader *current_shader, uint32_t tex_off,
+                    uint8_t level) const;
 
 public:
   /*!
@@ -81,16 +103,45 @@ public:
   virtual ~object();
   /*!
    @brief Render the object
-   @param target_camera The camera to render the object with
+   @details Models with lower detail levels are drawn at the level their size
+    on the screen calls for, bypassing draw()
+   @param target_camera The camera to render the object with, or nullptr to
+    render it at full detail
    @param current_shader The shader to render the object with
    @param tex_off The offset to start the textures at
   */
   virtual void render(const camera *target_camera, const shader *current_shader,
                       uint32_t tex_off) const;
+  /*!
+   @brief Render the object into the cached shadow maps of the static objects
+   @details The cached maps outlive the view, so the detail level can't
+    follow the camera. The coarsest level is drawn, as the lower levels lie
+    within the higher ones, so it never shadows the object as the camera
+    draws it. Objects overriding render() should override this as well.
+   @param current_shader The shader to render the object with
+   @param tex_off The offset to start the textures at
+  */
+  virtual void render_shadow(const shader *current_shader,
+                             uint32_t tex_off) const;
+  /*!
+   @brief Prepares the object for the next frame
+   @details Called by the scene once per frame, before anything is drawn, so
+    that every pass of the frame draws the same state. Overrides have to call
+    this as well
+   @warning Called from the thread holding the OpenGL context
+  */
+  virtual void begin_frame() const;
   /*!
    @brief Draws the object onto the viewport
   */
   virtual void draw() const;
+  /*!
+   @brief Picks the detail level to draw the model of the object at
+   @param target_camera The camera the object is viewed through
+   @return The level, 0 being the full detail, or the object having no model
+    or bounds
+  */
+  uint8_t get_lod(const camera *target_camera) const;
   /*!
    @brief Add a texture to the object
    @param tex The texture to add
@@ -179,4 +230,51 @@ public:
    @param active whether the object is active
   */
   void set_active(bool active);
+  /*!
+   @brief Checks if the camera draws the object in the current frame
+   @return True if the object is visible
+  */
+  bool is_visible() const;
+  /*!
+   @brief Sets whether the camera should draw the object
+   @details Unlike inactive ones, hidden static objects are still drawn into
+    the cached shadow maps, so that the camera moving around doesn't
+    invalidate them. Takes effect from the next frame on
+   @param visible whether the object is visible
+  */
+  void set_visible(bool visible);
+  /*!
+   @brief Checks if an object is static
+   @return True if the object never moves
+  */
+  bool is_static() const;
+  /*!
+   @brief Marks an object as static, allowing its shadows to be cached
+   @param static_caster whether the object never moves
+   @warning Has to be set before the object is added to a scene
+  */
+  void set_static(bool static_caster);
+  /*!
+   @brief Gets the axis aligned box enclosing the object in world space
+   @param low Set to the lower corner of the box
+   @param high Set to the upper corner of the box
+   @return False if the object can't be bounded, in which case it should never
+    be culled
+  */
+  virtual bool get_world_bounds(glm::vec3 &low, glm::vec3 &high) const;
+  /*!
+   @brief Gets the revision of the geometry of the object
+   @details Static objects whose geometry changes over time, like streamed
+    terrain, should return a different value after every change, so that
+    caches depending on it get invalidated
+   @return The revision, 0 by default
+  */
+  virtual uint32_t get_revision() const;
+  /*!
+   @brief Draws the parts of the object that hide what is behind them
+   @details Occluders have to lie entirely within the object, and should be
+    cheap, a few dozen triangles at most. Nothing by default.
+   @param buffer The buffer to draw the occluders into
+  */
+  virtual void draw_occluders(occlusion_buffer &buffer) const;
 };
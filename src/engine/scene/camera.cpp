@@ -31,6 +31,8 @@ glm::mat4 camera::get_projection_matrix(float aspect_ratio) const {
                           RENDER_MAX);
 }
 
+float camera::get_fov() const { return fov; }
+
 glm::vec3 camera::get_position() const { return position; }
 
 void camera::set_position(glm::vec3 position) { this->position = position; }
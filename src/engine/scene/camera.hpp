@@ -60,6 +60,11 @@ public:
    @return The projection matrix of the camera
   */
   glm::mat4 get_projection_matrix(float aspect_ratio) const;
+  /*!
+   @brief Get the field of view of the camera
+   @return The vertical field of view, in degrees
+  */
+  float get_fov() const;
   /*!
    @brief Get the position of the camera
    @return The position of the camera
@@ -0,0 +1,129 @@
+#include "directional_light.hpp"
+
+#include "../utils/stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+directional_light::directional_light(glm::vec3 direction, glm::vec3 color)
+    : direction(glm::normalize(direction)), color(color), active(true) {
+  glGenFramebuffers(1, &framebuffer);
+  glGenTextures(1, &depth_maps);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, depth_maps);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24,
+               SHADOW_CASCADE_RES, SHADOW_CASCADE_RES, SHADOW_CASCADES, 0,
+               GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+  // sampled with hardware filtered depth compares
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE,
+                  GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_maps, 0,
+                            0);
+#ifndef WASM
+  glDrawBuffer(GL_NONE);
+#endif
+  glReadBuffer(GL_NONE);
+
+#ifndef WASM
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    throw std::runtime_error("Framebuffer is not complete!");
+  }
+#endif
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+directional_light::~directional_light() {
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteTextures(1, &depth_maps);
+}
+
+const glm::vec3 &directional_light::get_direction() const { return direction; }
+
+void directional_light::set_direction(glm::vec3 direction) {
+  this->direction = glm::normalize(direction);
+}
+
+const glm::vec3 &directional_light::get_color() const { return color; }
+
+void directional_light::set_color(glm::vec3 color) { this->color = color; }
+
+void directional_light::update_cascades(const camera &target_camera,
+                                        float aspect_ratio) {
+  glm::mat4 view = target_camera.get_view_matrix();
+  // the light looks from the origin, so that snapping is the same everywhere
+  glm::vec3 up = fabsf(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : UP;
+  glm::mat4 light_view = glm::lookAt(glm::vec3(0.0f), direction, up);
+  float low = RENDER_MIN;
+  for (uint8_t i = 0; i < SHADOW_CASCADES; i++) {
+    // the practical split scheme, between logarithmic and uniform splits
+    float part = (float)(i + 1) / SHADOW_CASCADES;
+    float high =
+        SHADOW_CASCADE_LAMBDA * RENDER_MIN *
+            powf(SHADOW_CASCADE_FAR / RENDER_MIN, part) +
+        (1.0f - SHADOW_CASCADE_LAMBDA) *
+            (RENDER_MIN + (SHADOW_CASCADE_FAR - RENDER_MIN) * part);
+    glm::mat4 inverse = glm::inverse(
+        glm::perspective(glm::radians(target_camera.get_fov()), aspect_ratio,
+                         low, high) *
+        view);
+    glm::vec3 corners[8];
+    glm::vec3 center(0.0f);
+    for (uint8_t c = 0; c < 8; c++) {
+      glm::vec4 corner = inverse * glm::vec4(c & 1 ? 1.0f : -1.0f,
+                                             c & 2 ? 1.0f : -1.0f,
+                                             c & 4 ? 1.0f : -1.0f, 1.0f);
+      corners[c] = glm::vec3(corner) / corner.w;
+      center += corners[c] / 8.0f;
+    }
+    // a sphere doesn't change size as the camera turns
+    float radius = 0.0f;
+    for (uint8_t c = 0; c < 8; c++) {
+      radius = std::max(radius, glm::distance(corners[c], center));
+    }
+    radius = ceilf(radius * 16.0f) / 16.0f;
+    // move the center in whole texels, so that the rasterization is stable
+    glm::vec3 origin = light_view * glm::vec4(center, 1.0f);
+    float texel = 2.0f * radius / SHADOW_CASCADE_RES;
+    origin.x = floorf(origin.x / texel) * texel;
+    origin.y = floorf(origin.y / texel) * texel;
+    cascades[i] = glm::ortho(origin.x - radius, origin.x + radius,
+                             origin.y - radius, origin.y + radius,
+                             -origin.z - radius - SHADOW_CASCADE_BACKOFF,
+                             -origin.z + radius) *
+                  light_view;
+    eyes[i] = center - direction * (radius + SHADOW_CASCADE_BACKOFF);
+    low = high;
+  }
+}
+
+const glm::mat4 *directional_light::get_cascades() const { return cascades; }
+
+const glm::vec3 &directional_light::get_eye(uint8_t cascade) const {
+  return eyes[cascade];
+}
+
+void directional_light::bind_cascade(uint8_t cascade) const {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_maps, 0,
+                            cascade);
+  glViewport(0, 0, SHADOW_CASCADE_RES, SHADOW_CASCADE_RES);
+  glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void directional_light::use_depth_maps(int texture_unit) const {
+  stats::count(STAT_TEXTURE_BINDS);
+  glActiveTexture(GL_TEXTURE0 + texture_unit);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, depth_maps);
+}
+
+bool directional_light::is_active() const { return active; }
+
+void directional_light::set_active(bool active) { this->active = active; }
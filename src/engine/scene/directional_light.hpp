@@ -0,0 +1,101 @@
+
+#pragma once
+
+#include "../settings.hpp"
+#include "camera.hpp"
+
+/*!
+ @brief An infinitely distant light, like the sun or the moon
+ @details Shadows are rendered with cascaded shadow maps. The camera frustum,
+  up to SHADOW_CASCADE_FAR, is split into SHADOW_CASCADES slices, each covered
+  by its own orthographic depth map, so that the resolution is spent close to
+  the camera. The depth maps are stored in the layers of a single array
+  texture.
+*/
+class directional_light {
+private:
+  glm::vec3 direction;
+  glm::vec3 color;
+  GLuint framebuffer;
+  GLuint depth_maps;
+  /*!
+   @brief The light space matrix of each cascade
+  */
+  glm::mat4 cascades[SHADOW_CASCADES];
+  /*!
+   @brief The point each cascade is rendered from
+  */
+  glm::vec3 eyes[SHADOW_CASCADES];
+  bool active;
+
+public:
+  /*!
+   @brief Constructs a directional light
+   @param direction the direction the light shines in
+   @param color the color of the light (rgb)
+   @warning Requires an OpenGL context to be current
+  */
+  directional_light(glm::vec3 direction, glm::vec3 color);
+  ~directional_light();
+  /*!
+   @brief Gets the direction of the light
+   @return the normalized direction the light shines in
+  */
+  const glm::vec3 &get_direction() const;
+  /*!
+   @brief Sets the direction of the light
+   @param direction the direction the light shines in
+  */
+  void set_direction(glm::vec3 direction);
+  /*!
+   @brief Gets the color of the light
+   @return the color of the light
+  */
+  const glm::vec3 &get_color() const;
+  /*!
+   @brief Sets the color of the light
+   @param color the new color of the light
+  */
+  void set_color(glm::vec3 color);
+  /*!
+   @brief Fits the cascades to the view of a camera
+   @details Each cascade is fit around the bounding sphere of its slice, and
+    snapped to whole texels, so that the shadows don't shimmer as the camera
+    moves or turns
+   @param target_camera the camera the scene is viewed through
+   @param aspect_ratio the aspect ratio of the viewport
+  */
+  void update_cascades(const camera &target_camera, float aspect_ratio);
+  /*!
+   @brief Gets the light space matrices of the cascades
+   @return SHADOW_CASCADES matrices, nearest cascade first
+  */
+  const glm::mat4 *get_cascades() const;
+  /*!
+   @brief Gets the point a cascade is rendered from
+   @param cascade the index of the cascade
+   @return the point, on the near plane of the cascade
+  */
+  const glm::vec3 &get_eye(uint8_t cascade) const;
+  /*!
+   @brief Binds and clears the depth map of a cascade, and sets the viewport
+    to it
+   @param cascade the index of the cascade
+  */
+  void bind_cascade(uint8_t cascade) const;
+  /*!
+   @brief Uses the depth maps of the cascades
+   @param texture_unit the texture unit to bind the array texture to
+  */
+  void use_depth_maps(int texture_unit) const;
+  /*!
+   @brief Checks if the light is active
+   @return True if this light is active
+  */
+  bool is_active() const;
+  /*!
+   @brief Sets whether the light should emit light
+   @param active whether the light is active
+  */
+  void set_active(bool active);
+};
@@ -3,12 +3,16 @@
 
 #include "../abc/moveable.hpp"
 #include "../abc/view.hpp"
+#include "../gl/shadow_atlas.hpp"
 #include "../gl/texture.hpp"
 
 #include <string>
 
 /*!
  @brief a simple invisible light source
+ @details The first MAX_LIGHTS active lights of a scene get a shadow map, and
+  only light what their shadow map covers. The rest shine in every direction,
+  without shadows.
 */
 class light : public moveable, public view {
 private:
@@ -17,10 +21,28 @@ private:
   glm::vec3 color;
   float fov;
   float range;
-  unsigned int depthMapFBO;
-  unsigned int depthMap;
-  glm::vec3 get_front() const;
-  glm::vec3 get_up() const;
+  /*!
+   @brief The atlas holding the depth map of this light
+  */
+  const shadow_atlas *atlas;
+  /*!
+   @brief The tile of the atlas this light renders to
+  */
+  uint16_t tile;
+  ///@{
+  /*!
+   @brief The pose the depth map of the light was rendered from
+   @details Only follows the light once it moves past SHADOW_CACHE_DISTANCE or
+    turns past SHADOW_CACHE_ANGLE, so that the cached depth map stays valid
+  */
+  glm::vec3 shadow_position, shadow_rotation;
+  ///@}
+  /*!
+   @brief Whether the static casters in the cached depth map are up to date
+  */
+  bool shadow_cached;
+  static glm::vec3 get_front(glm::vec3 rotation);
+  static glm::vec3 get_up(glm::vec3 rotation);
   bool active;
 
 public:
@@ -48,6 +70,8 @@ public:
   const glm::vec3 &get_position() const;
   /*!
    @brief Get the light space matrix
+   @details Uses the pose the depth map was rendered from, which lags behind
+    the light by up to the cache thresholds
    @return the matrix that transforms coordinates from the world space to the
       light space
   */
@@ -74,8 +98,46 @@ public:
   void translate(glm::vec3 translation);
   void rotate(glm::vec3 rotation);
   void set_rotation(glm::vec3 rotation);
+  /*!
+   @brief Assigns the light a tile of a shadow atlas to render its depth map to
+   @param atlas the atlas
+   @param tile the index of the tile
+  */
+  void set_shadow_tile(const shadow_atlas *atlas, uint16_t tile);
+  /*!
+   @brief Moves the shadow pose to the light, if it moved too far from it
+   @return True if the cached static depth map has to be rendered again
+  */
+  bool update_shadow_pose();
+  /*!
+   @brief Marks the cached static depth map as up to date
+  */
+  void validate_shadow();
+  /*!
+   @brief Marks the cached static depth map as stale
+  */
+  void invalidate_shadow();
+  /*!
+   @brief Gets the position the depth map was rendered from
+   @return the position
+  */
+  const glm::vec3 &get_shadow_position() const;
+  /*!
+   @brief Gets the tile of the atlas this light renders to
+   @return the index of the tile
+  */
+  uint16_t get_shadow_tile() const;
+  /*!
+   @brief Gets where the depth map of the light lies in its atlas
+   @return the offset of the tile in xy and its size in zw, in texture
+    coordinates
+  */
+  glm::vec4 get_shadow_rect() const;
   /*!
    @brief Binds the depth map of the light
+   @details Binds the atlas and sets the viewport to the tile of this light.
+    The atlas is cleared once for all the lights, so the tile isn't cleared
+    here.
   */
   void bind_view_map() const;
   /*!
@@ -85,7 +147,8 @@ public:
   void use_depth_map(int texture_unit) const;
   /*!
    @brief Gets the depth map of the light
-   @return a new texture object based on the depth map of this light
+   @return a new texture object based on the atlas holding the depth map of
+    this light
    @warning the caller is responsible for deleting the texture object
   */
   texture *get_view_map() const;
@@ -0,0 +1,181 @@
+#include "light_clusters.hpp"
+
+#include "../utils/stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+
+light_clusters::light_clusters()
+    : index_rows(1), light_rows(1), grid(CLUSTER_COUNT * 2, 0) {
+  grid_texture = create_texture(GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT,
+                                CLUSTER_X, CLUSTER_Y * CLUSTER_Z);
+  index_texture = create_texture(GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT,
+                                 CLUSTER_INDEX_WIDTH, index_rows);
+  light_texture =
+      create_texture(GL_RGBA32F, GL_RGBA, GL_FLOAT, 2, light_rows);
+}
+
+light_clusters::~light_clusters() {
+  glDeleteTextures(1, &grid_texture);
+  glDeleteTextures(1, &index_texture);
+  glDeleteTextures(1, &light_texture);
+}
+
+GLuint light_clusters::create_texture(GLint internal_format, GLenum format,
+                                      GLenum type, GLsizei width,
+                                      GLsizei height) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, format,
+               type, NULL);
+  // integer textures are incomplete with any other filter
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
+
+void light_clusters::upload(GLuint texture, GLint internal_format,
+                            GLenum format, GLenum type, GLsizei width,
+                            GLsizei height, GLsizei &allocated,
+                            const void *data, size_t size) {
+  stats::count(STAT_BUFFER_UPLOAD_BYTES, size);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  if (height > allocated) {
+    // grow geometrically, so that the texture isn't reallocated every frame
+    allocated = std::max(height, allocated * 2);
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, allocated, 0,
+                 format, type, NULL);
+  }
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, type, data);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+glm::vec2 light_clusters::get_slice_params() {
+  float scale = CLUSTER_Z / logf(CLUSTER_FAR / CLUSTER_NEAR);
+  return glm::vec2(scale, logf(CLUSTER_NEAR) * scale);
+}
+
+int light_clusters::get_slice(float depth) {
+  if (depth <= CLUSTER_NEAR) {
+    return 0;
+  }
+  glm::vec2 params = get_slice_params();
+  return std::min((int)(logf(depth) * params.x - params.y), CLUSTER_Z - 1);
+}
+
+void light_clusters::update(const camera &target_camera, float aspect_ratio,
+                            const std::list<light *> &lights) {
+  glm::mat4 view = target_camera.get_view_matrix();
+  glm::mat4 projection = target_camera.get_projection_matrix(aspect_ratio);
+  light_data.clear();
+  bounds.clear();
+  uint32_t shadows = 0;
+  for (const light *lght : lights) {
+    if (!lght->is_active()) {
+      continue;
+    }
+    // the shadow pass gives the depth maps to the first active lights
+    float shadow = shadows < MAX_LIGHTS ? (float)shadows++ : -1.0f;
+    if (light_data.size() / 2 >= CLUSTER_MAX_LIGHTS) {
+      break;
+    }
+    glm::vec3 center = view * glm::vec4(lght->get_position(), 1.0f);
+    float range = lght->get_range();
+    if (center.z - range > -RENDER_MIN) {
+      // entirely behind the camera
+      continue;
+    }
+    glm::ivec3 low(0), high(CLUSTER_X - 1, CLUSTER_Y - 1, 0);
+    // if the light crosses the near plane it may cover the whole screen
+    if (center.z + range < -RENDER_MIN) {
+      glm::vec2 ndc_low(INFINITY), ndc_high(-INFINITY);
+      for (uint8_t c = 0; c < 8; c++) {
+        glm::vec4 corner =
+            projection * glm::vec4(center + glm::vec3(c & 1 ? range : -range,
+                                                      c & 2 ? range : -range,
+                                                      c & 4 ? range : -range),
+                                   1.0f);
+        glm::vec2 ndc = glm::vec2(corner) / corner.w;
+        ndc_low = glm::min(ndc_low, ndc);
+        ndc_high = glm::max(ndc_high, ndc);
+      }
+      low.x = (int)floorf((ndc_low.x * 0.5f + 0.5f) * CLUSTER_X);
+      low.y = (int)floorf((ndc_low.y * 0.5f + 0.5f) * CLUSTER_Y);
+      high.x = (int)floorf((ndc_high.x * 0.5f + 0.5f) * CLUSTER_X);
+      high.y = (int)floorf((ndc_high.y * 0.5f + 0.5f) * CLUSTER_Y);
+      if (high.x < 0 || high.y < 0 || low.x >= CLUSTER_X ||
+          low.y >= CLUSTER_Y) {
+        // off the screen
+        continue;
+      }
+      low = glm::max(low, glm::ivec3(0));
+      high = glm::min(high, glm::ivec3(CLUSTER_X - 1, CLUSTER_Y - 1, 0));
+    }
+    low.z = get_slice(-center.z - range);
+    high.z = get_slice(-center.z + range);
+    bounds.push_back(low);
+    bounds.push_back(high);
+    light_data.push_back(glm::vec4(lght->get_position(), range));
+    light_data.push_back(glm::vec4(lght->get_color(), shadow));
+  }
+  // count the lights of each cluster, then turn the counts into offsets
+  std::fill(grid.begin(), grid.end(), 0);
+  for (size_t i = 0; i < bounds.size(); i += 2) {
+    for (int z = bounds[i].z; z <= bounds[i + 1].z; z++) {
+      for (int y = bounds[i].y; y <= bounds[i + 1].y; y++) {
+        for (int x = bounds[i].x; x <= bounds[i + 1].x; x++) {
+          grid[(x + CLUSTER_X * (y + CLUSTER_Y * z)) * 2 + 1]++;
+        }
+      }
+    }
+  }
+  uint32_t total = 0;
+  for (uint32_t cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+    grid[cluster * 2] = total;
+    total += std::min(grid[cluster * 2 + 1], (uint32_t)CLUSTER_CAPACITY);
+    grid[cluster * 2 + 1] = 0;
+  }
+  GLsizei rows = std::max(
+      (total + CLUSTER_INDEX_WIDTH - 1) / CLUSTER_INDEX_WIDTH, (uint32_t)1);
+  indices.resize(rows * CLUSTER_INDEX_WIDTH);
+  for (size_t i = 0; i < bounds.size(); i += 2) {
+    for (int z = bounds[i].z; z <= bounds[i + 1].z; z++) {
+      for (int y = bounds[i].y; y <= bounds[i + 1].y; y++) {
+        for (int x = bounds[i].x; x <= bounds[i + 1].x; x++) {
+          uint32_t *cluster = &grid[(x + CLUSTER_X * (y + CLUSTER_Y * z)) * 2];
+          // the lights past the limit are dropped
+          if (cluster[1] < CLUSTER_CAPACITY) {
+            indices[cluster[0] + cluster[1]++] = i / 2;
+          }
+        }
+      }
+    }
+  }
+  GLsizei grid_rows = CLUSTER_Y * CLUSTER_Z;
+  upload(grid_texture, GL_RG32UI, GL_RG_INTEGER, GL_UNSIGNED_INT, CLUSTER_X,
+         grid_rows, grid_rows, grid.data(), grid.size() * sizeof(uint32_t));
+  upload(index_texture, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT,
+         CLUSTER_INDEX_WIDTH, rows, index_rows, indices.data(),
+         indices.size() * sizeof(uint32_t));
+  if (!light_data.empty()) {
+    upload(light_texture, GL_RGBA32F, GL_RGBA, GL_FLOAT, 2,
+           light_data.size() / 2, light_rows, light_data.data(),
+           light_data.size() * sizeof(glm::vec4));
+  }
+}
+
+void light_clusters::use(int texture_unit) const {
+  stats::count(STAT_TEXTURE_BINDS, 3);
+  glActiveTexture(GL_TEXTURE0 + texture_unit);
+  glBindTexture(GL_TEXTURE_2D, grid_texture);
+  glActiveTexture(GL_TEXTURE0 + texture_unit + 1);
+  glBindTexture(GL_TEXTURE_2D, index_texture);
+  glActiveTexture(GL_TEXTURE0 + texture_unit + 2);
+  glBindTexture(GL_TEXTURE_2D, light_texture);
+}
@@ -0,0 +1,110 @@
+
+#pragma once
+
+#include "../settings.hpp"
+#include "camera.hpp"
+#include "light.hpp"
+
+#include <list>
+#include <vector>
+
+/*!
+ @brief Assigns the lights of a scene to the clusters of the view frustum
+ @details The frustum is split into CLUSTER_X by CLUSTER_Y tiles on the screen
+  and CLUSTER_Z exponential depth slices. Every frame the light volumes are
+  tested against the clusters on the CPU, and each cluster gets a list of the
+  lights that reach it, so that fragments only evaluate the nearby lights.
+  Everything is stored in plain integer and float textures read with
+  texelFetch, as texture buffers and storage buffers are missing in WebGL.
+*/
+class light_clusters {
+private:
+  /*!
+   @brief The offset and the count of the light indices of every cluster
+  */
+  GLuint grid_texture;
+  /*!
+   @brief The light indices of all the clusters, CLUSTER_INDEX_WIDTH per row
+  */
+  GLuint index_texture;
+  /*!
+   @brief Two texels per light, the position and range, then the color and
+    the index of its shadow map
+  */
+  GLuint light_texture;
+  ///@{
+  /*!
+   @brief The number of rows allocated in the textures
+  */
+  GLsizei index_rows, light_rows;
+  ///@}
+  std::vector<uint32_t> grid;
+  std::vector<uint32_t> indices;
+  std::vector<glm::vec4> light_data;
+  /*!
+   @brief The range of clusters each light reaches, low corner then high
+  */
+  std::vector<glm::ivec3> bounds;
+  /*!
+   @brief Creates a texture read with texelFetch
+   @param internal_format The format of the texture
+   @param format The format of the data
+   @param type The type of the data
+   @param width The width of the texture
+   @param height The height of the texture
+   @return The new texture
+  */
+  static GLuint create_texture(GLint internal_format, GLenum format,
+                               GLenum type, GLsizei width, GLsizei height);
+  /*!
+   @brief Uploads rows to one of the textures, growing it as needed
+   @param texture The texture to upload to
+   @param internal_format The format of the texture
+   @param format The format of the data
+   @param type The type of the data
+   @param width The width of the texture
+   @param height The number of rows to upload
+   @param allocated The number of rows allocated, updated if the texture grows
+   @param data The rows
+   @param size The size of the data, in bytes
+  */
+  static void upload(GLuint texture, GLint internal_format, GLenum format,
+                     GLenum type, GLsizei width, GLsizei height,
+                     GLsizei &allocated, const void *data, size_t size);
+  /*!
+   @brief Gets the depth slice a view space depth falls into
+   @param depth The distance from the camera, along its view direction
+   @return The index of the slice
+  */
+  static int get_slice(float depth);
+
+public:
+  /*!
+   @brief Constructs an empty cluster grid
+   @warning Requires an OpenGL context to be current
+  */
+  light_clusters();
+  ~light_clusters();
+  /*!
+   @brief Assigns the lights to the clusters, and uploads the result
+   @details The first MAX_LIGHTS active lights are given the shadow maps, in
+    the same order as in the shadow pass. At most CLUSTER_MAX_LIGHTS lights
+    are assigned.
+   @param target_camera The camera the scene is rendered with
+   @param aspect_ratio The aspect ratio of the viewport
+   @param lights The lights of the scene
+  */
+  void update(const camera &target_camera, float aspect_ratio,
+              const std::list<light *> &lights);
+  /*!
+   @brief Binds the textures of the grid to three consecutive texture units
+   @param texture_unit The first of the texture units
+  */
+  void use(int texture_unit) const;
+  /*!
+   @brief Gets how a fragment depth maps to a slice
+   @return The scale and the bias, so that the slice of a depth is
+    log(depth) * scale - bias
+  */
+  static glm::vec2 get_slice_params();
+};
@@ -0,0 +1,146 @@
+#include "occlusion_buffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+occlusion_buffer::occlusion_buffer(uint16_t width, uint16_t height)
+    : width(width), height(height),
+      tiles_x((width + OCCLUSION_TILE - 1) / OCCLUSION_TILE),
+      tiles_y((height + OCCLUSION_TILE - 1) / OCCLUSION_TILE),
+      depth((size_t)width * height, 0.0f),
+      tile_depth((size_t)tiles_x * tiles_y, 0.0f), view_projection(1.0f) {}
+
+occlusion_buffer::~occlusion_buffer() {}
+
+void occlusion_buffer::clear(const glm::mat4 &view_projection) {
+  this->view_projection = view_projection;
+  std::fill(depth.begin(), depth.end(), 0.0f);
+}
+
+bool occlusion_buffer::project(glm::vec3 point, glm::vec3 &projected) const {
+  glm::vec4 clip = view_projection * glm::vec4(point, 1.0f);
+  if (clip.w < RENDER_MIN) {
+    return false;
+  }
+  float inverse = 1.0f / clip.w;
+  projected = glm::vec3((clip.x * inverse * 0.5f + 0.5f) * width,
+                        (clip.y * inverse * 0.5f + 0.5f) * height, inverse);
+  return true;
+}
+
+void occlusion_buffer::draw_triangle(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+  glm::vec3 p0, p1, p2;
+  if (!project(a, p0) || !project(b, p1) || !project(c, p2)) {
+    return;
+  }
+  float area = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+  if (std::abs(area) < 1e-6f) {
+    return;
+  }
+  // either winding, occluders have no back faces
+  float sign = area > 0.0f ? 1.0f : -1.0f;
+  float inverse_area = 1.0f / area;
+  glm::vec3 low = glm::min(glm::min(p0, p1), p2);
+  glm::vec3 high = glm::max(glm::max(p0, p1), p2);
+  int32_t min_x = (int32_t)floorf(glm::clamp(low.x, 0.0f, (float)width));
+  int32_t min_y = (int32_t)floorf(glm::clamp(low.y, 0.0f, (float)height));
+  int32_t max_x = (int32_t)ceilf(glm::clamp(high.x, 0.0f, (float)width));
+  int32_t max_y = (int32_t)ceilf(glm::clamp(high.y, 0.0f, (float)height));
+  for (int32_t y = min_y; y < max_y; y++) {
+    float center_y = y + 0.5f;
+    for (int32_t x = min_x; x < max_x; x++) {
+      float center_x = x + 0.5f;
+      // the edge functions, sampled at the center of the pixel
+      float w0 = (p2.x - p1.x) * (center_y - p1.y) -
+                 (p2.y - p1.y) * (center_x - p1.x);
+      float w1 = (p0.x - p2.x) * (center_y - p2.y) -
+                 (p0.y - p2.y) * (center_x - p2.x);
+      float w2 = (p1.x - p0.x) * (center_y - p0.y) -
+                 (p1.y - p0.y) * (center_x - p0.x);
+      if (w0 * sign < 0.0f || w1 * sign < 0.0f || w2 * sign < 0.0f) {
+        continue;
+      }
+      float value = (w0 * p0.z + w1 * p1.z + w2 * p2.z) * inverse_area;
+      float &pixel = depth[(size_t)y * width + x];
+      pixel = std::max(pixel, value);
+    }
+  }
+}
+
+void occlusion_buffer::draw_box(glm::vec3 low, glm::vec3 high,
+                                const glm::mat4 &model) {
+  glm::vec3 corners[8];
+  for (uint8_t i = 0; i < 8; i++) {
+    corners[i] = model * glm::vec4(i & 1 ? high.x : low.x,
+                                   i & 2 ? high.y : low.y,
+                                   i & 4 ? high.z : low.z, 1.0f);
+  }
+  // two triangles per face, the corners indexed by their axis bits
+  static const uint8_t faces[6][4] = {{0, 2, 4, 6}, {1, 3, 5, 7},
+                                      {0, 1, 4, 5}, {2, 3, 6, 7},
+                                      {0, 1, 2, 3}, {4, 5, 6, 7}};
+  for (const auto &face : faces) {
+    draw_triangle(corners[face[0]], corners[face[1]], corners[face[2]]);
+    draw_triangle(corners[face[2]], corners[face[1]], corners[face[3]]);
+  }
+}
+
+void occlusion_buffer::finish() {
+  for (uint16_t tile_y = 0; tile_y < tiles_y; tile_y++) {
+    for (uint16_t tile_x = 0; tile_x < tiles_x; tile_x++) {
+      float farthest = std::numeric_limits<float>::infinity();
+      uint16_t end_x = std::min((tile_x + 1) * OCCLUSION_TILE, (int)width);
+      uint16_t end_y = std::min((tile_y + 1) * OCCLUSION_TILE, (int)height);
+      for (uint16_t y = tile_y * OCCLUSION_TILE; y < end_y; y++) {
+        for (uint16_t x = tile_x * OCCLUSION_TILE; x < end_x; x++) {
+          farthest = std::min(farthest, depth[(size_t)y * width + x]);
+        }
+      }
+      tile_depth[(size_t)tile_y * tiles_x + tile_x] = farthest;
+    }
+  }
+}
+
+bool occlusion_buffer::check_box(glm::vec3 low, glm::vec3 high) const {
+  glm::vec3 lower(std::numeric_limits<float>::infinity());
+  glm::vec3 upper = -lower;
+  for (uint8_t i = 0; i < 8; i++) {
+    glm::vec3 projected;
+    if (!project(glm::vec3(i & 1 ? high.x : low.x, i & 2 ? high.y : low.y,
+                           i & 4 ? high.z : low.z),
+                 projected)) {
+      return true;
+    }
+    lower = glm::min(lower, projected);
+    upper = glm::max(upper, projected);
+  }
+  // the nearest point of the box, which any occluder has to be in front of
+  float nearest = upper.z;
+  int32_t min_x = (int32_t)floorf(glm::clamp(lower.x, 0.0f, (float)width));
+  int32_t min_y = (int32_t)floorf(glm::clamp(lower.y, 0.0f, (float)height));
+  int32_t max_x = (int32_t)ceilf(glm::clamp(upper.x, 0.0f, (float)width));
+  int32_t max_y = (int32_t)ceilf(glm::clamp(upper.y, 0.0f, (float)height));
+  for (int32_t tile_y = min_y / OCCLUSION_TILE;
+       tile_y * OCCLUSION_TILE < max_y; tile_y++) {
+    for (int32_t tile_x = min_x / OCCLUSION_TILE;
+         tile_x * OCCLUSION_TILE < max_x; tile_x++) {
+      // the whole tile is covered by nearer occluders
+      if (tile_depth[(size_t)tile_y * tiles_x + tile_x] > nearest) {
+        continue;
+      }
+      int32_t end_x = std::min((tile_x + 1) * OCCLUSION_TILE, max_x);
+      int32_t end_y = std::min((tile_y + 1) * OCCLUSION_TILE, max_y);
+      for (int32_t y = std::max(tile_y * OCCLUSION_TILE, min_y); y < end_y;
+           y++) {
+        for (int32_t x = std::max(tile_x * OCCLUSION_TILE, min_x); x < end_x;
+             x++) {
+          if (depth[(size_t)y * width + x] <= nearest) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
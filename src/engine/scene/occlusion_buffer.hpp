@@ -0,0 +1,86 @@
+
+#pragma once
+
+#include "../include.hpp"
+#include "../settings.hpp"
+
+#include <vector>
+
+/*!
+ @brief A low resolution depth buffer, rasterized on the CPU
+ @details The biggest occluders of a scene are drawn into it every frame, and
+  the bounding boxes of the other objects are then tested against it, so that
+  objects hidden behind them are never sent to the GPU. Every pixel holds the
+  reciprocal of the view depth of the nearest occluder, which interpolates
+  linearly across the screen, and 0 where there is none. A second level keeps
+  the farthest occluder of every OCCLUSION_TILE sized tile, so that most tests
+  only read a handful of values.
+*/
+class occlusion_buffer {
+private:
+  uint16_t width, height;
+  ///@{
+  /*!
+   @brief The number of tiles along each axis
+  */
+  uint16_t tiles_x, tiles_y;
+  ///@}
+  std::vector<float> depth;
+  /*!
+   @brief The farthest occluder of every tile
+  */
+  std::vector<float> tile_depth;
+  glm::mat4 view_projection;
+  /*!
+   @brief Projects a point onto the buffer
+   @param point The point in world space
+   @param projected Set to the position in pixels in xy, and the reciprocal of
+    the view depth in z
+   @return False if the point is behind the near plane
+  */
+  bool project(glm::vec3 point, glm::vec3 &projected) const;
+
+public:
+  /*!
+   @brief Constructs an empty occlusion buffer
+   @param width The width of the buffer in pixels
+   @param height The height of the buffer in pixels
+  */
+  occlusion_buffer(uint16_t width, uint16_t height);
+  ~occlusion_buffer();
+  /*!
+   @brief Clears the buffer, and sets the view it is drawn from
+   @param view_projection The matrix transforming world space into clip space
+  */
+  void clear(const glm::mat4 &view_projection);
+  /*!
+   @brief Draws an occluding triangle
+   @details Triangles crossing the near plane are skipped, which only makes
+    the buffer more conservative
+   @param a The first vertex, in world space
+   @param b The second vertex, in world space
+   @param c The third vertex, in world space
+  */
+  void draw_triangle(glm::vec3 a, glm::vec3 b, glm::vec3 c);
+  /*!
+   @brief Draws an occluding box
+   @param low The lower corner of the box, in model space
+   @param high The upper corner of the box, in model space
+   @param model The matrix transforming model space into world space
+  */
+  void draw_box(glm::vec3 low, glm::vec3 high, const glm::mat4 &model);
+  /*!
+   @brief Builds the tiles, has to be called after the occluders are drawn,
+    and before any box is tested
+  */
+  void finish();
+  /*!
+   @brief Checks if any part of a box might be visible
+   @details Conservative, boxes crossing the near plane are always visible.
+    Boxes outside of the view are not.
+   @param low The lower corner of the box, in world space
+   @param high The upper corner of the box, in world space
+   @return False if the box is certainly hidden behind the occluders
+  */
+  bool check_box(glm::vec3 low, glm::vec3 high) const;
+};
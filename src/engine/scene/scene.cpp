@@ -1,12 +1,23 @@
 #include "scene.hpp"
 
 #include "../settings.hpp"
+#include "../utils/collision.hpp"
+#include "../utils/profiler.hpp"
+#include "../utils/stats.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 scene::scene(glm::vec3 ambient_light, glm::vec3 background_color)
-    : ambient_light(ambient_light), background_color(background_color),
-      sky(nullptr), current_time(glfwGetTime()), delta_time(0.0) {}
+    : samples(MSAA_SAMPLES), depth_prepass(DEPTH_PREPASS),
+      occlusion_culling(OCCLUSION_CULLING),
+      occlusion(OCCLUSION_WIDTH, OCCLUSION_HEIGHT),
+      ambient_light(ambient_light), background_color(background_color),
+      sun(nullptr), sky(nullptr), light_pass_shader(nullptr),
+      layered_pass_shader(nullptr), atlas(nullptr), static_atlas(nullptr),
+      clusters(nullptr), static_revision(0), static_changes(0),
+      current_time(glfwGetTime()), delta_time(0.0) {}
 
 scene::~scene() {}
 
@@ -16,17 +27,64 @@ void scene::set_skybox(const shader *skybox_shader, skybox *sky) {
 }
 
 void scene::add_object(const shader *target_shader, const object *obj) {
-  objects[target_shader].push_back(obj);
+  std::lock_guard<std::mutex> lock(changes_mutex);
+  change added = {target_shader, obj};
+  changes.push_back(added);
+  if (obj->is_static()) {
+    static_changes++;
+  }
 }
 
 void scene::remove_object(const object *obj) {
-  for (auto &pair : objects) {
-    pair.second.remove(obj);
+  std::lock_guard<std::mutex> lock(changes_mutex);
+  change removed = {nullptr, obj};
+  changes.push_back(removed);
+  if (obj->is_static()) {
+    static_changes++;
+  }
+}
+
+void scene::apply_changes() {
+  {
+    std::lock_guard<std::mutex> lock(changes_mutex);
+    // replayed in order, so an object removed and added again stays
+    for (const change &current : changes) {
+      if (current.target_shader != nullptr) {
+        slot_handle handle =
+            objects[current.target_shader].insert(current.obj);
+        handles.insert(std::make_pair(
+            current.obj, std::make_pair(current.target_shader, handle)));
+        continue;
+      }
+      auto range = handles.equal_range(current.obj);
+      for (auto it = range.first; it != range.second; it++) {
+        objects[it->second.first].erase(it->second.second);
+      }
+      handles.erase(range.first, range.second);
+    }
+    changes.clear();
+  }
+  // once per object, even if it is drawn with multiple shaders
+  for (auto it = handles.begin(); it != handles.end();
+       it = handles.equal_range(it->first).second) {
+    it->first->begin_frame();
   }
 }
 
 void scene::add_light(light *light) { lights.push_back(light); }
 
+void scene::set_sun(directional_light *sun) { this->sun = sun; }
+
+void scene::set_depth_prepass(bool depth_prepass) {
+  this->depth_prepass = depth_prepass;
+}
+
+void scene::set_occlusion_culling(bool occlusion_culling) {
+  this->occlusion_culling = occlusion_culling;
+}
+
+uint8_t scene::get_samples() const { return samples; }
+
 void scene::add_collider(const collider *collider) {
   colliders.push_back(collider);
 }
@@ -34,22 +92,228 @@ void scene::add_collider(const collider *collider) {
 void scene::init(camera *) {
   light_pass_shader = new shader(SHADER_PATH("light_pass.vert"),
                                  SHADER_PATH("light_pass.frag"));
+#ifndef WASM
+  if (GLEW_VERSION_4_1) {
+    layered_pass_shader = new shader(SHADER_PATH("light_pass_layered.vert"),
+                                     SHADER_PATH("light_pass_layered.geom"),
+                                     SHADER_PATH("light_pass.frag"));
+  }
+#endif
+  atlas = new shadow_atlas();
+  static_atlas = new shadow_atlas();
+  clusters = new light_clusters();
   initialized = true;
 }
 
+void scene::deinit() {
+  delete light_pass_shader;
+  delete layered_pass_shader;
+  delete atlas;
+  delete static_atlas;
+  delete clusters;
+  light_pass_shader = nullptr;
+  layered_pass_shader = nullptr;
+  atlas = nullptr;
+  static_atlas = nullptr;
+  clusters = nullptr;
+  initialized = false;
+}
+
 void scene::clear() const {
   glClearColor(background_color.r, background_color.g, background_color.b,
                1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
+void scene::sort_objects(glm::vec3 eye) {
+  render_queue.resize(objects.size());
+  std::vector<std::pair<float, const object *>> sorted;
+  size_t bucket = 0;
+  for (const auto &collection : objects) {
+    sorted.clear();
+    for (const object *obj : collection.second) {
+      if (!obj->is_active() || !obj->is_visible()) {
+        continue;
+      }
+      if (occluded.count(obj) != 0) {
+        stats::count(STAT_CULLED_OBJECTS);
+        continue;
+      }
+      glm::vec3 low, high, center = obj->get_position();
+      if (obj->get_world_bounds(low, high)) {
+        center = (low + high) * 0.5f;
+      }
+      glm::vec3 offset = center - eye;
+      sorted.push_back(std::make_pair(glm::dot(offset, offset), obj));
+    }
+    std::sort(sorted.begin(), sorted.end());
+    render_queue[bucket].first = collection.first;
+    std::vector<const object *> &queue = render_queue[bucket].second;
+    queue.clear();
+    for (const auto &pair : sorted) {
+      queue.push_back(pair.second);
+    }
+    bucket++;
+  }
+}
+
+/*!
+ @brief Grows a box by the shadow it casts along a direction
+ @param direction The direction the light shines in
+ @param low The lower corner of the box
+ @param high The upper corner of the box
+ @return False if the light is too low for the shadow to be bounded
+*/
+static bool extend_shadow(glm::vec3 direction, glm::vec3 &low,
+                          glm::vec3 &high) {
+  direction = glm::normalize(direction);
+  // grazing light casts shadows too long to be worth bounding
+  if (direction.y > -0.1f) {
+    return false;
+  }
+  // until the shadow falls below the object
+  glm::vec3 end =
+      direction * ((high.y - low.y + OCCLUSION_SHADOW_DROP) / -direction.y);
+  low = glm::min(low, low + end);
+  high = glm::max(high, high + end);
+  return true;
+}
+
+/*!
+ @brief Grows a box by the shadow it casts from a point
+ @details Bounds the part of the cone the box casts from the point that lies
+  within the range, along with the point itself
+ @param position The position of the light
+ @param range The range of the light
+ @param low The lower corner of the box
+ @param high The upper corner of the box
+ @return False if the box is too wide, as seen from the light, to be bounded
+*/
+static bool extend_shadow(glm::vec3 position, float range, glm::vec3 &low,
+                          glm::vec3 &high) {
+  glm::vec3 rays[8];
+  for (uint8_t i = 0; i < 8; i++) {
+    glm::vec3 ray = glm::vec3(i & 1 ? high.x : low.x, i & 2 ? high.y : low.y,
+                              i & 4 ? high.z : low.z) -
+                    position;
+    if (glm::dot(ray, ray) == 0.0f) {
+      return false;
+    }
+    rays[i] = glm::normalize(ray);
+  }
+  // every direction within the cone is an average of the rays, at least this
+  // long, so the cone fits within the rays scaled by its inverse
+  float spread = 1.0f;
+  for (uint8_t i = 0; i < 8; i++) {
+    for (uint8_t j = i + 1; j < 8; j++) {
+      spread = std::min(spread, glm::dot(rays[i], rays[j]));
+    }
+  }
+  if (spread <= 0.0f) {
+    return false;
+  }
+  float length = range / sqrtf(spread);
+  low = glm::min(low, position);
+  high = glm::max(high, position);
+  for (uint8_t i = 0; i < 8; i++) {
+    low = glm::min(low, position + rays[i] * length);
+    high = glm::max(high, position + rays[i] * length);
+  }
+  return true;
+}
+
+void scene::update_occlusion(const camera &target_camera,
+                             float aspect_ratio) const {
+  occluded.clear();
+  sun_occluded.clear();
+  if (!occlusion_culling) {
+    return;
+  }
+  profile_scope occlusion_scope("occlusion culling");
+  glm::vec3 eye = target_camera.get_position();
+  occlusion.clear(target_camera.get_projection_matrix(aspect_ratio) *
+                  target_camera.get_view_matrix());
+  for (const auto &collection : objects) {
+    for (const object *obj : collection.second) {
+      glm::vec3 low, high;
+      if (!obj->is_active() || !obj->is_visible() ||
+          (obj->get_world_bounds(low, high) &&
+           glm::distance(glm::clamp(eye, low, high), eye) >
+               OCCLUDER_DISTANCE)) {
+        continue;
+      }
+      obj->draw_occluders(occlusion);
+    }
+  }
+  occlusion.finish();
+  bool has_sun = sun != nullptr && sun->is_active();
+  for (const auto &collection : objects) {
+    for (const object *obj : collection.second) {
+      glm::vec3 low, high;
+      if (!obj->is_active() || !obj->is_visible() ||
+          !obj->get_world_bounds(low, high) || occlusion.check_box(low, high)) {
+        continue;
+      }
+      occluded.insert(obj);
+      if (has_sun && extend_shadow(sun->get_direction(), low, high) &&
+          !occlusion.check_box(low, high)) {
+        sun_occluded.insert(obj);
+      }
+    }
+  }
+}
+
+bool scene::is_shadow_occluded(const object *obj, const light *lght) const {
+  if (occluded.count(obj) == 0) {
+    return false;
+  }
+  glm::vec3 low, high;
+  obj->get_world_bounds(low, high);
+  return extend_shadow(lght->get_position(), lght->get_range(), low, high) &&
+         !occlusion.check_box(low, high);
+}
+
+const shader *scene::get_prepass_shader(const shader *target) const {
+  if (target->get_depth_shader() != nullptr) {
+    return target->get_depth_shader();
+  }
+  if (target->is_opaque() && target->is_shadow_simple()) {
+    return light_pass_shader;
+  }
+  return nullptr;
+}
+
+const shader *scene::get_shadow_shader(const shader *target) const {
+  if (target->is_shadow_simple()) {
+    return light_pass_shader;
+  }
+  if (target->get_depth_shader() != nullptr) {
+    return target->get_depth_shader();
+  }
+  return target;
+}
+
+void scene::set_alpha_to_coverage(const shader *target) const {
+#if ALPHA_TO_COVERAGE
+  if (target->is_alpha_tested()) {
+    glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+  } else {
+    glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+  }
+#else
+  (void)target;
+#endif
+}
+
 void scene::render(const camera &target_camera, uint16_t width,
                    uint16_t height) {
+  profile_scope render_scope("render", true);
   clear();
   float aspect_ratio = (float)width / (float)height;
   glm::mat4 projection = target_camera.get_projection_matrix(aspect_ratio);
   glm::mat4 view = target_camera.get_view_matrix();
   if (sky != nullptr) {
+    profile_scope skybox_scope("skybox", true);
     // special projection matrix that removes the translation
     glm::mat4 viewProjection = projection * glm::mat4(glm::mat3(view));
     skybox_shader->use();
@@ -58,81 +322,301 @@ void scene::render(const camera &target_camera, uint16_t width,
     sky->render(&target_camera, skybox_shader, 0);
   }
   glm::mat4 viewProjection = projection * view;
-  for (auto collection : objects) {
-    const shader *current_shader = collection.first;
+  {
+    profile_scope cluster_scope("light clusters");
+    clusters->update(target_camera, aspect_ratio, lights);
+  }
+  // the shadowed lights, in the same order as in the shadow pass
+  glm::mat4 shadow_matrices[MAX_LIGHTS];
+  glm::vec4 shadow_rects[MAX_LIGHTS];
+  uint32_t shadows = 0;
+  for (const light *lght : lights) {
+    if (!lght->is_active() || shadows >= MAX_LIGHTS) {
+      continue;
+    }
+    shadow_matrices[shadows] = lght->get_light_space();
+    shadow_rects[shadows] = lght->get_shadow_rect();
+    shadows++;
+  }
+  glm::vec2 slice_params = light_clusters::get_slice_params();
+  glm::vec4 cluster_params((float)CLUSTER_X / width, (float)CLUSTER_Y / height,
+                           slice_params.x, slice_params.y);
+  // nearer objects first, so that the depth test rejects what they hide
+  sort_objects(target_camera.get_position());
+  if (depth_prepass) {
+    profile_scope prepass_scope("depth prepass", true);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    for (const auto &bucket : render_queue) {
+      const shader *prepass_shader = get_prepass_shader(bucket.first);
+      if (prepass_shader == nullptr) {
+        continue;
+      }
+      prepass_shader->use();
+      prepass_shader->apply_uniform_mat4(viewProjection, "viewProjection");
+      prepass_shader->apply_uniform_vec3(target_camera.get_position(),
+                                         "viewPos");
+      prepass_shader->apply_uniform(ALPHA_TO_COVERAGE &&
+                                        bucket.first->is_alpha_tested(),
+                                    "alphaToCoverage");
+      set_alpha_to_coverage(bucket.first);
+      for (const object *obj : bucket.second) {
+        obj->render(&target_camera, prepass_shader, 0);
+      }
+    }
+    glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  }
+  for (const auto &bucket : render_queue) {
+    profile_scope bucket_scope("shader bucket", true);
+    const shader *current_shader = bucket.first;
+    // the depth of the prepassed objects is already known, so only the
+    // visible fragments get shaded
+    bool prepassed =
+        depth_prepass && get_prepass_shader(current_shader) != nullptr;
+    if (prepassed) {
+      glDepthFunc(GL_EQUAL);
+      glDepthMask(GL_FALSE);
+    }
+    set_alpha_to_coverage(current_shader);
     current_shader->use();
     current_shader->apply_uniform_mat4(viewProjection, "viewProjection");
     current_shader->apply_uniform_vec3(target_camera.get_position(), "viewPos");
+    current_shader->apply_uniform_vec3(target_camera.get_front(), "viewFront");
     current_shader->apply_uniform_vec3(ambient_light, "ambientLight");
 
-    uint32_t i = 0;
-    for (auto light : lights) {
-      if (!light->is_active()) {
-        continue;
-      }
-      std::string name = "lights[" + std::to_string(i) + "]";
-      current_shader->apply_uniform_vec3(light->get_position(),
-                                         name + ".position");
-      current_shader->apply_uniform_vec3(light->get_color(), name + ".color");
-      current_shader->apply_uniform_mat4(light->get_light_space(),
-                                         name + ".lightSpaceMatrix");
-      current_shader->apply_uniform_scalar(light->get_range(), name + ".range");
-      light->use_depth_map(i);
-      current_shader->apply_uniform(i, name + ".depthMap");
-      i++;
+    // all the depth maps are in the atlas, on the first texture unit
+    atlas->use(0);
+    current_shader->apply_uniform(0, "shadowAtlas");
+    current_shader->apply_uniform_mat4(shadow_matrices, shadows,
+                                       "shadowMatrices");
+    current_shader->apply_uniform_vec4(shadow_rects, shadows, "shadowRects");
+    // the light lists take the three units after the cascades
+    clusters->use(2);
+    current_shader->apply_uniform(2, "clusterGrid");
+    current_shader->apply_uniform(3, "lightIndices");
+    current_shader->apply_uniform(4, "lightData");
+    current_shader->apply_uniform_vec4(cluster_params, "clusterParams");
+    // the cascades get the second unit, even without a sun, as samplers of
+    // different types can't share a unit
+    current_shader->apply_uniform(1, "sunShadow");
+    bool has_sun = sun != nullptr && sun->is_active();
+    current_shader->apply_uniform(has_sun, "hasSun");
+    if (has_sun) {
+      sun->use_depth_maps(1);
+      current_shader->apply_uniform_vec3(sun->get_direction(),
+                                         "sun.direction");
+      current_shader->apply_uniform_vec3(sun->get_color(), "sun.color");
+      current_shader->apply_uniform_mat4(sun->get_cascades(), SHADOW_CASCADES,
+                                         "sun.cascades");
     }
-    current_shader->apply_uniform(i, "numLights");
 
-    for (const object *obj : collection.second) {
-      if (!obj->is_active()) {
-        continue;
-      }
-      obj->render(&target_camera, current_shader, i);
+    for (const object *obj : bucket.second) {
+      obj->render(&target_camera, current_shader, 5);
+    }
+    if (prepassed) {
+      glDepthFunc(GL_LESS);
+      glDepthMask(GL_TRUE);
     }
     glUseProgram(0);
   }
+  glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
 }
 
-void scene::shadow_pass() const {
-  // resize the viewport to the shadow resolution
-  glViewport(0, 0, SHADOW_RES, SHADOW_RES);
-  glCullFace(GL_FRONT);
-  // activate the super simple shader for the shadow pass
-  light_pass_shader->use();
-  for (const light *lght : lights) {
-    if (!lght->is_active()) {
-      continue;
+void scene::draw_casters(const camera &target_camera,
+                         const shadow_atlas *target,
+                         const std::vector<light *> &casters,
+                         bool static_casters) const {
+  if (casters.empty()) {
+    return;
+  }
+  if (layered_pass_shader != nullptr) {
+    // the geometry shader picks the viewport of each light
+    glm::mat4 lightProjections[MAX_LIGHTS];
+    for (size_t i = 0; i < casters.size(); i++) {
+      lightProjections[i] = casters[i]->get_light_space();
+      target->set_viewport(casters[i]->get_shadow_tile(), i);
     }
-    lght->bind_view_map(); // activate the framebuffer
+    layered_pass_shader->use();
+    layered_pass_shader->apply_uniform_mat4(lightProjections, casters.size(),
+                                            "lightSpaceMatrices");
+    layered_pass_shader->apply_uniform(casters.size(), "numLights");
+    for (const auto &collection : objects) {
+      if (!collection.first->is_shadow_simple()) {
+        continue;
+      }
+      for (const object *obj : collection.second) {
+        // the cached static maps hold the hidden static objects as well
+        if (!obj->is_active() || obj->is_static() != static_casters ||
+            (!static_casters && !obj->is_visible())) {
+          continue;
+        }
+        // the cached static maps outlive the view, so only moving objects
+        // are culled
+        if (!static_casters &&
+            std::all_of(casters.begin(), casters.end(),
+                        [this, obj](const light *lght) {
+                          return is_shadow_occluded(obj, lght);
+                        })) {
+          stats::count(STAT_CULLED_OBJECTS);
+          continue;
+        }
+        if (static_casters) {
+          obj->render_shadow(layered_pass_shader, 0);
+        } else {
+          obj->render(&target_camera, layered_pass_shader, 0);
+        }
+      }
+    }
+  }
+  for (const light *lght : casters) {
+    profile_scope light_scope("shadow map", true);
+    target->set_viewport(lght->get_shadow_tile());
     glm::mat4 lightProjection = lght->get_light_space();
-    // draw all the objects
-    for (auto collection : objects) {
+    // draw the objects the layered pass couldn't
+    for (const auto &collection : objects) {
       const shader *current_shader = collection.first;
       if (current_shader->is_shadow_simple()) {
+        if (layered_pass_shader != nullptr) {
+          continue;
+        }
         light_pass_shader->use();
         light_pass_shader->apply_uniform_mat4(lightProjection,
                                               "viewProjection");
         current_shader = light_pass_shader;
       } else {
+        current_shader = get_shadow_shader(current_shader);
         current_shader->use();
         current_shader->apply_uniform_mat4(lightProjection, "viewProjection");
-        current_shader->apply_uniform_vec3(lght->get_position(), "viewPos");
+        current_shader->apply_uniform_vec3(lght->get_shadow_position(),
+                                           "viewPos");
+        current_shader->apply_uniform(false, "alphaToCoverage");
       }
       for (const object *obj : collection.second) {
-        if (!obj->is_active()) {
+        if (!obj->is_active() || obj->is_static() != static_casters ||
+            (!static_casters && !obj->is_visible())) {
           continue;
         }
-        obj->render(nullptr, current_shader, 0);
+        if (!static_casters && is_shadow_occluded(obj, lght)) {
+          stats::count(STAT_CULLED_OBJECTS);
+          continue;
+        }
+        if (static_casters) {
+          obj->render_shadow(current_shader, 0);
+        } else {
+          obj->render(&target_camera, current_shader, 0);
+        }
+      }
+    }
+  }
+}
+
+void scene::draw_cascades(const camera &target_camera,
+                          float aspect_ratio) const {
+  sun->update_cascades(target_camera, aspect_ratio);
+  const glm::mat4 *cascades = sun->get_cascades();
+  for (uint8_t cascade = 0; cascade < SHADOW_CASCADES; cascade++) {
+    profile_scope cascade_scope("shadow cascade", true);
+    sun->bind_cascade(cascade);
+    for (const auto &collection : objects) {
+      const shader *current_shader = get_shadow_shader(collection.first);
+      current_shader->use();
+      current_shader->apply_uniform_mat4(cascades[cascade], "viewProjection");
+      current_shader->apply_uniform_vec3(sun->get_eye(cascade), "viewPos");
+      current_shader->apply_uniform(false, "alphaToCoverage");
+      for (const object *obj : collection.second) {
+        if (!obj->is_active() || !obj->is_visible()) {
+          continue;
+        }
+        if (sun_occluded.count(obj) != 0) {
+          stats::count(STAT_CULLED_OBJECTS);
+          continue;
+        }
+        glm::vec3 low, high;
+        if (obj->get_world_bounds(low, high) &&
+            !check_box_frustum(low, high, cascades[cascade])) {
+          stats::count(STAT_CULLED_OBJECTS);
+          continue;
+        }
+        obj->render(&target_camera, current_shader, 0);
+      }
+    }
+  }
+}
+
+/*!
+ @brief Scrambles a value, so that sums of the results don't collide
+ @param value The value
+ @return The scrambled value
+*/
+static uint64_t scramble(uint64_t value) {
+  // the finalizer of splitmix64
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+  return value ^ (value >> 31);
+}
+
+void scene::shadow_pass(const camera &target_camera, uint16_t width,
+                        uint16_t height) const {
+  profile_scope shadow_scope("shadow pass", true);
+  // the render pass culls against the same occluders
+  update_occlusion(target_camera, (float)width / (float)height);
+  // every light keeps its tile, even while inactive
+  atlas->reserve(lights.size());
+  bool reallocated = static_atlas->reserve(lights.size());
+  // any change to the static casters invalidates all of the cached maps,
+  // including one static object being switched off as another is switched on
+  uint64_t revision = static_changes;
+  for (const auto &collection : objects) {
+    for (const object *obj : collection.second) {
+      if (obj->is_static() && obj->is_active()) {
+        revision += scramble((uintptr_t)obj ^
+                             scramble(obj->get_revision()));
       }
     }
-    // cleanup
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
   }
+  bool invalidate = reallocated || revision != static_revision;
+  static_revision = revision;
+  std::vector<light *> casters, stale;
+  uint16_t tile = 0;
+  for (light *lght : lights) {
+    lght->set_shadow_tile(atlas, tile++);
+    if (invalidate) {
+      lght->invalidate_shadow();
+    }
+    if (lght->is_active() && casters.size() < MAX_LIGHTS) {
+      casters.push_back(lght);
+      if (lght->update_shadow_pose()) {
+        stale.push_back(lght);
+      }
+    }
+  }
+  glCullFace(GL_FRONT);
+  if (sun != nullptr && sun->is_active()) {
+    profile_scope sun_scope("sun shadow maps", true);
+    draw_cascades(target_camera, (float)width / (float)height);
+  }
+  if (!stale.empty()) {
+    profile_scope static_scope("static shadow maps", true);
+    for (light *lght : stale) {
+      static_atlas->clear(lght->get_shadow_tile());
+      lght->validate_shadow();
+    }
+    draw_casters(target_camera, static_atlas, stale, true);
+  }
+  {
+    profile_scope dynamic_scope("dynamic shadow maps", true);
+    // start from the cached static casters, and draw the moving ones on top
+    atlas->copy(*static_atlas);
+    draw_casters(target_camera, atlas, casters, false);
+  }
+  // cleanup
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
   glUseProgram(0);
   glCullFace(GL_BACK);
 }
 
 void scene::main(camera *target_camera, bool *should_close) {
+  profiler::get().name_thread("update");
   while (!*should_close) {
     if (!this->initialized) {
       continue;
@@ -142,7 +626,11 @@ void scene::main(camera *target_camera, bool *should_close) {
       delta_time = new_time - current_time;
       current_time = new_time;
     }
-    this->update(target_camera, delta_time, current_time);
+    {
+      profile_scope update_scope("update");
+      this->update(target_camera, delta_time, current_time);
+    }
+    profiler::get().end_frame();
   }
 }
 
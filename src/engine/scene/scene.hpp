@@ -2,10 +2,20 @@
 #pragma once
 
 #include "../abc/collider.hpp"
+#include "../gl/shadow_atlas.hpp"
 #include "../renderable/object.hpp"
 #include "../renderable/skybox.hpp"
+#include "../utils/slot_map.hpp"
+#include "directional_light.hpp"
+#include "light_clusters.hpp"
+#include "occlusion_buffer.hpp"
 
+#include <atomic>
 #include <list>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 /*!
  @brief Scene class to handle rendering of objects.
@@ -20,15 +30,161 @@ protected:
    @brief Clears the screen to the assigned color
   */
   void clear() const;
+  /*!
+   @brief The number of samples per pixel of the window the scene is rendered
+    to, MSAA_SAMPLES unless the scene needs a single sampled window
+  */
+  uint8_t samples;
 
 private:
-  std::unordered_map<const shader *, std::list<const object *>> objects;
-  std::list<const light *> lights;
+  /*!
+   @brief The objects of every shader
+   @details Only modified by the render thread, between frames
+  */
+  std::unordered_map<const shader *, slot_map<const object *>> objects;
+  /*!
+   @brief Where each object is kept in objects
+  */
+  std::unordered_multimap<const object *,
+                          std::pair<const shader *, slot_handle>>
+      handles;
+  /*!
+   @brief An object added to or removed from the scene
+  */
+  struct change {
+    /*!
+     @brief The shader to render an added object with, nullptr on removal
+    */
+    const shader *target_shader;
+    const object *obj;
+  };
+  /*!
+   @brief The changes since the last frame, in the order they were made
+  */
+  std::vector<change> changes;
+  std::mutex changes_mutex;
+  std::list<light *> lights;
   std::list<const collider *> colliders;
+  /*!
+   @brief The active objects of every shader, sorted front to back
+   @details Rebuilt every frame, but kept to reuse the allocations
+  */
+  std::vector<std::pair<const shader *, std::vector<const object *>>>
+      render_queue;
+  /*!
+   @brief Whether opaque objects are drawn to the depth buffer first
+  */
+  bool depth_prepass;
+  /*!
+   @brief Whether objects hidden behind the occluders are skipped
+  */
+  bool occlusion_culling;
+  /*!
+   @brief The occluders of the scene, as seen by the camera
+  */
+  mutable occlusion_buffer occlusion;
+  /*!
+   @brief The objects hidden from the camera
+  */
+  mutable std::unordered_set<const object *> occluded;
+  /*!
+   @brief The hidden objects whose shadow cast by the directional light is
+    hidden as well
+  */
+  mutable std::unordered_set<const object *> sun_occluded;
   glm::vec3 ambient_light;
   glm::vec3 background_color;
+  /*!
+   @brief The directional light of the scene, if any
+  */
+  directional_light *sun;
   skybox *sky;
   const shader *light_pass_shader, *skybox_shader;
+  /*!
+   @brief Renders simple objects to the depth maps of all lights at once
+   @details Null if geometry shaders with multiple viewports are unsupported
+  */
+  const shader *layered_pass_shader;
+  /*!
+   @brief Holds the depth maps of all the lights
+  */
+  shadow_atlas *atlas;
+  /*!
+   @brief Holds the cached depth maps of the static objects only
+   @details Copied into the atlas every frame, before the dynamic objects are
+    drawn on top
+  */
+  shadow_atlas *static_atlas;
+  /*!
+   @brief The lights, sorted into the clusters of the view frustum
+  */
+  light_clusters *clusters;
+  /*!
+   @brief The state of the static objects the cached depth maps were rendered
+    with
+  */
+  mutable uint64_t static_revision;
+  /*!
+   @brief How many times static objects were added or removed
+  */
+  std::atomic<uint32_t> static_changes;
+  /*!
+   @brief Draws the cascades of the directional light
+   @param target_camera The camera the cascades are fit to
+   @param aspect_ratio The aspect ratio of the viewport
+  */
+  void draw_cascades(const camera &target_camera, float aspect_ratio) const;
+  /*!
+   @brief Draws either the static or the dynamic objects into the depth maps
+    of some lights
+   @param target_camera The camera the detail levels of the dynamic objects
+    are picked by, the static ones are drawn with render_shadow()
+   @param target The atlas to draw into
+   @param casters The lights to draw the depth maps of
+   @param static_casters Whether to draw the static objects, or the others
+  */
+  void draw_casters(const camera &target_camera, const shadow_atlas *target,
+                    const std::vector<light *> &casters,
+                    bool static_casters) const;
+  /*!
+   @brief Draws the occluders, and finds the objects hidden behind them
+   @details Objects without bounds, like the terrain, and those within
+    OCCLUDER_DISTANCE of the camera draw their occluders
+   @param target_camera The camera the scene will be rendered with
+   @param aspect_ratio The aspect ratio of the viewport
+  */
+  void update_occlusion(const camera &target_camera, float aspect_ratio) const;
+  /*!
+   @brief Checks if the shadow an object casts from a light can't be seen
+   @param obj The object
+   @param lght The light
+   @return True if both the object and its shadow are hidden
+  */
+  bool is_shadow_occluded(const object *obj, const light *lght) const;
+  /*!
+   @brief Fills the render queue, leaving out the occluded objects
+   @param eye The position the scene is viewed from
+  */
+  void sort_objects(glm::vec3 eye);
+  /*!
+   @brief Gets the shader that draws the objects of a shader in the prepass
+   @param target The shader of the objects
+   @return The shader, or nullptr if the objects aren't prepassed
+  */
+  const shader *get_prepass_shader(const shader *target) const;
+  /*!
+   @brief Gets the shader that draws the objects of a shader in the shadow
+    passes
+   @param target The shader of the objects
+   @return The light pass shader for simple shaders, else the depth shader of
+    the target, if it has one, else the target itself
+  */
+  const shader *get_shadow_shader(const shader *target) const;
+  /*!
+   @brief Toggles alpha to coverage for the objects of a shader
+   @param target The shader of the objects
+  */
+  void set_alpha_to_coverage(const shader *target) const;
   double current_time, delta_time;
 
 public:
@@ -47,20 +203,56 @@ public:
   void set_skybox(const shader *skybox_shader, skybox *sky);
   /*!
    @brief Add an object to the scene
+   @details The object is drawn from the next frame on
    @param target_shader The shader to render the object with
    @param obj The object to add
   */
   void add_object(const shader *target_shader, const object *obj);
   /*!
    @brief Remove an object from the scene
+   @details The object is drawn until the next frame starts, so it has to be
+    kept alive until then
    @param obj The object to remove
   */
   void remove_object(const object *obj);
+  /*!
+   @brief Applies the objects added and removed since the last frame
+   @details Every change takes constant time, so whole flocks can come and go
+    at once. Afterwards every object is prepared for the frame with
+    object::begin_frame()
+   @warning Has to be called from the render thread, before the frame is drawn
+  */
+  void apply_changes();
   /*!
    @brief Add a light to the scene
    @param light The light to add
   */
   void add_light(light *light);
+  /*!
+   @brief Sets the directional light of the scene
+   @param sun The light, or nullptr to remove it
+  */
+  void set_sun(directional_light *sun);
+  /*!
+   @brief Sets whether opaque objects are drawn to the depth buffer first
+   @details With the prepass the main pass of opaque objects only shades the
+    visible fragments, using GL_EQUAL depth tests
+   @param depth_prepass Whether to perform the depth prepass
+  */
+  void set_depth_prepass(bool depth_prepass);
+  /*!
+   @brief Sets whether objects hidden behind others are skipped
+   @details The occluders are rasterized on the CPU, at the start of the
+    shadow pass, and the bounds of the objects are tested against them
+   @param occlusion_culling Whether to perform occlusion culling
+  */
+  void set_occlusion_culling(bool occlusion_culling);
+  /*!
+   @brief Gets the number of samples per pixel the scene should be rendered
+    with
+   @return The number of samples, 1 if multisampling isn't wanted
+  */
+  uint8_t get_samples() const;
   /*!
    @brief Add a collider to the scene
    @param collider The collider to add
@@ -71,8 +263,19 @@ public:
    @param target_camera the camera that will be used in the scene
   */
   virtual void init(camera *target_camera);
+  /*!
+   @brief Release what the scene shares between its objects on the GPU
+   @warning Called by the renderer, while the OpenGL context still exists
+  */
+  virtual void deinit();
   /*!
    @brief Render the scene
+   @details The lights are sorted into the clusters of the view frustum first,
+    so that every fragment only evaluates the lights that reach it. The
+    objects are drawn front to back, after an optional depth prepass of the
+    opaque ones, and of those with a depth shader. Alpha tested shaders are
+    drawn with alpha to coverage. Objects found hidden by the last shadow
+    pass are skipped.
    @param target_camera The camera to render the scene with
    @param width The width of the viewport
    @param height The height of the viewport
@@ -81,9 +284,21 @@ public:
                       uint16_t height);
   /*!
    @brief Perform the shadow pass
+   @details Objects with simple shaders are drawn once, for all lights, if
+    layered rendering is supported. The rest are drawn once per light. The
+    depth of static objects is cached, and only drawn again once a light
+    moves, or the static objects change, so most frames only draw the dynamic
+    objects. The directional light is drawn per cascade, culling the objects
+    outside of each. Objects hidden from the camera, whose shadows are hidden
+    as well, are skipped, except in the cached depth maps, which outlive the
+    view they would be culled against.
+   @param target_camera The camera the scene will be rendered with
+   @param width The width of the viewport
+   @param height The height of the viewport
    @warning May modify the viewport
   */
-  void shadow_pass() const;
+  void shadow_pass(const camera &target_camera, uint16_t width,
+                   uint16_t height) const;
   /*!
    @brief Main function of the scene
    @param target_camera The camera that the scene is being rendered with
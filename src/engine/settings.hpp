@@ -4,7 +4,81 @@
 #define SHADER_PATH(name) "shaders/" name
 #define MODEL_PATH(name) "models/" name
 
+// the resolution of the shadow map of a single light
 #define SHADOW_RES 2048
+// the largest the shadow atlas can get, before the shadow maps shrink
+#define SHADOW_ATLAS_MAX 8192
+// how far a light can move before its cached shadows are rendered again
+#define SHADOW_CACHE_DISTANCE 0.05f
+// how far a light can turn, in radians, before its shadows are rendered again
+#define SHADOW_CACHE_ANGLE 0.005f
+// the number of taps of the shadow filter, 1 (a single hardware filtered
+// compare), 4 (a 3x3 tent), 8 or 16 (Poisson disks)
+#define SHADOW_KERNEL 4
+// the number of cascades the shadows of directional lights are split into,
+// has to match the shaders
+#define SHADOW_CASCADES 4
+// the resolution of a single cascade
+#define SHADOW_CASCADE_RES 2048
+// how far from the camera directional lights cast shadows
+#define SHADOW_CASCADE_FAR 200.0f
+// blend between logarithmic (1) and uniform (0) cascade splits
+#define SHADOW_CASCADE_LAMBDA 0.8f
+// how far towards the light, beyond a cascade, objects still cast shadows
+#define SHADOW_CASCADE_BACKOFF 100.0f
+// the most lights that cast shadows at once, has to match the shaders
+#define MAX_LIGHTS 10
+// the number of samples per pixel of the windows, 1 to disable MSAA
+#define MSAA_SAMPLES 4
+// whether alpha tested shaders use alpha to coverage instead of discarding,
+// needs MSAA_SAMPLES above 1
+#define ALPHA_TO_COVERAGE 1
+// whether scenes draw opaque objects to the depth buffer before shading them
+#define DEPTH_PREPASS true
+// the clusters the view frustum is split into for lighting, on the screen
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+// and in depth
+#define CLUSTER_Z 24
+// the exponential depth slices span this range, with the first and the last
+// slice extending to the camera and to infinity
+#define CLUSTER_NEAR 1.0f
+#define CLUSTER_FAR 200.0f
+// the most lights a single cluster holds, the rest are dropped
+#define CLUSTER_CAPACITY 128
+// the most lights assigned to the clusters
+#define CLUSTER_MAX_LIGHTS 1024
+// the number of light indices in a row of the index texture
+#define CLUSTER_INDEX_WIDTH 1024
+// the number of lower detail levels built for loaded models
+#define MODEL_LODS 3
+// the fraction of the triangles each detail level keeps of the previous one
+#define MODEL_LOD_RATIO 0.5f
+// the size on the screen, as the radius of the bounds over half of the screen
+// height, below which models drop to their first lower detail level, halving
+// for every next one
+#define MODEL_LOD_SCREEN_SIZE 0.25f
+// the largest texture coordinate models can have to upload theirs as half
+// floats, which are precise to about a 2048th below it
+#define MODEL_HALF_UV_RANGE 2.0f
+// the number of entries of the vertex cache model indices are ordered for
+#define MESH_CACHE_SIZE 32
+// whether scenes skip the objects hidden behind the biggest occluders
+#define OCCLUSION_CULLING true
+// the resolution of the depth buffer the occluders are rasterized into
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+// the size of the tiles the occlusion tests check first
+#define OCCLUSION_TILE 8
+// how far from the camera bounded objects still draw their occluders
+#define OCCLUDER_DISTANCE 30.0f
+// how far below an object its shadow is assumed to land, when deciding
+// whether the shadow of a hidden object can be seen
+#define OCCLUSION_SHADOW_DROP 5.0f
+// the number of directions around the vertical axis impostors are baked from
+#define IMPOSTOR_VIEWS 8
+// the resolution of a single view of an impostor
+#define IMPOSTOR_RES 128
 
 enum axes { X, Y, Z };
 
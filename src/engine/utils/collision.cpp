@@ -50,3 +50,50 @@ bool check_line_box(glm::vec3 negbounds, glm::vec3 bounds, glm::vec3 a,
 
   return false;
 }
+
+bool check_line_triangle(glm::vec3 a, glm::vec3 b, glm::vec3 v0, glm::vec3 v1,
+                         glm::vec3 v2, float &t) {
+  // Moller-Trumbore, restricted to the segment
+  glm::vec3 direction = b - a;
+  glm::vec3 edge1 = v1 - v0, edge2 = v2 - v0;
+  glm::vec3 p = glm::cross(direction, edge2);
+  float det = glm::dot(edge1, p);
+  if (det == 0.0f) {
+    return false; // parallel to the triangle
+  }
+  float inv_det = 1.0f / det;
+  glm::vec3 s = a - v0;
+  float u = glm::dot(s, p) * inv_det;
+  if (u < 0.0f || u > 1.0f) {
+    return false;
+  }
+  glm::vec3 q = glm::cross(s, edge1);
+  float v = glm::dot(direction, q) * inv_det;
+  if (v < 0.0f || u + v > 1.0f) {
+    return false;
+  }
+  t = glm::dot(edge2, q) * inv_det;
+  return t >= 0.0f && t <= 1.0f;
+}
+
+bool check_box_frustum(glm::vec3 low, glm::vec3 high,
+                       const glm::mat4 &view_projection) {
+  // for each clip plane, the number of corners on its outer side
+  uint8_t outside[6] = {0, 0, 0, 0, 0, 0};
+  for (uint8_t i = 0; i < 8; i++) {
+    glm::vec4 corner =
+        view_projection * glm::vec4(i & 1 ? high.x : low.x,
+                                    i & 2 ? high.y : low.y,
+                                    i & 4 ? high.z : low.z, 1.0f);
+    for (uint8_t axis = 0; axis < 3; axis++) {
+      outside[axis * 2] += corner[axis] < -corner.w;
+      outside[axis * 2 + 1] += corner[axis] > corner.w;
+    }
+  }
+  for (uint8_t plane = 0; plane < 6; plane++) {
+    if (outside[plane] == 8) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -1,6 +1,86 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
 #include "../include.hpp"
 
 bool check_line_box(glm::vec3 negbounds, glm::vec3 bounds, glm::vec3 a,
                     glm::vec3 b, glm::vec3 &point);
+
+/*!
+ @brief Checks if a line segment intersects a triangle
+ @param a The start of the segment
+ @param b The end of the segment
+ @param v0 The first vertex of the triangle
+ @param v1 The second vertex of the triangle
+ @param v2 The third vertex of the triangle
+ @param t Set to the position of the intersection along the segment, 0 being
+  a and 1 being b
+ @return True if the segment intersects the triangle
+*/
+bool check_line_triangle(glm::vec3 a, glm::vec3 b, glm::vec3 v0, glm::vec3 v1,
+                         glm::vec3 v2, float &t);
+
+/*!
+ @brief Checks if a box can be seen through a view projection matrix
+ @details Conservative, the box is only rejected if all of its corners lie
+  outside the same clip plane
+ @param low The lower corner of the box
+ @param high The upper corner of the box
+ @param view_projection The matrix transforming world space into clip space
+ @return False if the box is certainly outside the view volume
+*/
+bool check_box_frustum(glm::vec3 low, glm::vec3 high,
+                       const glm::mat4 &view_projection);
+
+/*!
+ @brief Walks the cells of a 2D grid crossed by a segment, in order
+ @details A DDA traversal, with unit sized cells, so the cost is proportional
+  to the number of cells crossed
+ @param a The start of the segment, in cell units
+ @param b The end of the segment, in cell units
+ @param visit Called with the cell coordinates, and the positions along the
+  segment where it enters and exits the cell. Returning true stops the walk
+ @return True if the walk was stopped by visit
+*/
+template <typename F>
+bool traverse_grid(glm::vec2 a, glm::vec2 b, F visit) {
+  const float inf = std::numeric_limits<float>::infinity();
+  glm::vec2 direction = b - a;
+  int32_t x = (int32_t)floorf(a.x), y = (int32_t)floorf(a.y);
+  // the number of cells is known upfront, which protects us from drift
+  uint32_t cells = std::abs((int32_t)floorf(b.x) - x) +
+                   std::abs((int32_t)floorf(b.y) - y) + 1;
+  int32_t step_x = direction.x > 0 ? 1 : -1;
+  int32_t step_y = direction.y > 0 ? 1 : -1;
+  float delta_x = direction.x != 0 ? fabsf(1.0f / direction.x) : inf;
+  float delta_y = direction.y != 0 ? fabsf(1.0f / direction.y) : inf;
+  float next_x =
+      direction.x != 0
+          ? (direction.x > 0 ? x + 1 - a.x : a.x - x) * delta_x
+          : inf;
+  float next_y =
+      direction.y != 0
+          ? (direction.y > 0 ? y + 1 - a.y : a.y - y) * delta_y
+          : inf;
+  float enter = 0.0f;
+  for (uint32_t i = 0; i < cells; i++) {
+    float exit = std::min(std::min(next_x, next_y), 1.0f);
+    if (visit(x, y, enter, exit)) {
+      return true;
+    }
+    if (next_x < next_y) {
+      x += step_x;
+      enter = next_x;
+      next_x += delta_x;
+    } else {
+      y += step_y;
+      enter = next_y;
+      next_y += delta_y;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,170 @@
+#include "mesh_optimizer.hpp"
+
+#include "../settings.hpp"
+
+#include <cmath>
+
+/*!
+ @brief Scores a vertex by how much emitting its triangles next would help
+ @param cache_position The position of the vertex in the cache, or -1
+ @param remaining The number of triangles of the vertex not yet emitted
+ @return The score, higher is better
+*/
+static float get_vertex_score(int32_t cache_position, uint32_t remaining) {
+  if (remaining == 0) {
+    return -1.0f;
+  }
+  float score = 0.0f;
+  if (cache_position >= 0) {
+    if (cache_position < 3) {
+      // the vertices of the last triangle, deliberately lower so that the
+      // strips don't go back and forth
+      score = 0.75f;
+    } else {
+      score = powf(1.0f - (float)(cache_position - 3) / (MESH_CACHE_SIZE - 3),
+                   1.5f);
+    }
+  }
+  // vertices with few triangles left are worth finishing off
+  return score + 2.0f / sqrtf((float)remaining);
+}
+
+void optimize_vertex_cache(std::vector<unsigned int> &indices,
+                           size_t vertex_count) {
+  size_t triangle_count = indices.size() / 3;
+  // the triangles of every vertex not yet emitted, in a single list
+  std::vector<uint32_t> remaining(vertex_count, 0);
+  for (size_t i = 0; i < triangle_count * 3; i++) {
+    remaining[indices[i]]++;
+  }
+  std::vector<uint32_t> offsets(vertex_count + 1, 0);
+  for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+    offsets[vertex + 1] = offsets[vertex] + remaining[vertex];
+  }
+  std::vector<uint32_t> adjacency(triangle_count * 3);
+  std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < triangle_count * 3; i++) {
+    adjacency[filled[indices[i]]++] = i / 3;
+  }
+
+  std::vector<float> vertex_score(vertex_count);
+  for (size_t vertex = 0; vertex < vertex_count; vertex++) {
+    vertex_score[vertex] = get_vertex_score(-1, remaining[vertex]);
+  }
+  std::vector<bool> emitted(triangle_count, false);
+  std::vector<unsigned int> output;
+  output.reserve(triangle_count * 3);
+  std::vector<unsigned int> cache, next_cache;
+  cache.reserve(MESH_CACHE_SIZE + 3);
+  next_cache.reserve(MESH_CACHE_SIZE + 3);
+  // every triangle before it has been emitted
+  size_t scan = 0;
+  int64_t best = -1;
+  while (output.size() < triangle_count * 3) {
+    if (best < 0) {
+      // none of the cached vertices has triangles left, so we start over
+      while (emitted[scan]) {
+        scan++;
+      }
+      best = scan;
+    }
+    emitted[best] = true;
+    next_cache.clear();
+    for (uint8_t corner = 0; corner < 3; corner++) {
+      unsigned int vertex = indices[best * 3 + corner];
+      output.push_back(vertex);
+      // the triangle leaves the list of the vertex
+      uint32_t begin = offsets[vertex], end = begin + remaining[vertex];
+      for (uint32_t i = begin; i < end; i++) {
+        if (adjacency[i] == best) {
+          adjacency[i] = adjacency[end - 1];
+          remaining[vertex]--;
+          break;
+        }
+      }
+      bool cached = false;
+      for (unsigned int other : next_cache) {
+        cached |= other == vertex;
+      }
+      if (!cached) {
+        next_cache.push_back(vertex);
+      }
+    }
+    for (unsigned int vertex : cache) {
+      bool cached = false;
+      for (uint8_t corner = 0; corner < 3; corner++) {
+        cached |= indices[best * 3 + corner] == vertex;
+      }
+      if (!cached) {
+        next_cache.push_back(vertex);
+      }
+    }
+    // the vertices pushed out of the cache
+    for (size_t i = MESH_CACHE_SIZE; i < next_cache.size(); i++) {
+      unsigned int vertex = next_cache[i];
+      vertex_score[vertex] = get_vertex_score(-1, remaining[vertex]);
+    }
+    if (next_cache.size() > MESH_CACHE_SIZE) {
+      next_cache.resize(MESH_CACHE_SIZE);
+    }
+    for (size_t i = 0; i < next_cache.size(); i++) {
+      unsigned int vertex = next_cache[i];
+      vertex_score[vertex] = get_vertex_score(i, remaining[vertex]);
+    }
+    // the next triangle is the best one around the cached vertices
+    best = -1;
+    float best_score = -1.0f;
+    for (unsigned int vertex : next_cache) {
+      uint32_t begin = offsets[vertex], end = begin + remaining[vertex];
+      for (uint32_t i = begin; i < end; i++) {
+        uint32_t triangle = adjacency[i];
+        float score = vertex_score[indices[triangle * 3]] +
+                      vertex_score[indices[triangle * 3 + 1]] +
+                      vertex_score[indices[triangle * 3 + 2]];
+        if (score > best_score) {
+          best_score = score;
+          best = triangle;
+        }
+      }
+    }
+    cache.swap(next_cache);
+  }
+  indices.swap(output);
+}
+
+std::vector<unsigned int>
+get_fetch_remap(const std::vector<unsigned int> &indices,
+                size_t vertex_count) {
+  const unsigned int unused = (unsigned int)-1;
+  std::vector<unsigned int> remap(vertex_count, unused);
+  unsigned int next = 0;
+  for (unsigned int index : indices) {
+    if (remap[index] == unused) {
+      remap[index] = next++;
+    }
+  }
+  for (unsigned int &position : remap) {
+    if (position == unused) {
+      position = next++;
+    }
+  }
+  return remap;
+}
+
+float get_acmr(const std::vector<unsigned int> &indices, size_t vertex_count,
+               uint32_t cache_size) {
+  if (indices.size() < 3) {
+    return 0.0f;
+  }
+  // the time every vertex entered the cache, a vertex is cached if fewer
+  // than cache_size misses happened since
+  std::vector<uint64_t> entered(vertex_count, 0);
+  uint64_t misses = 0;
+  for (unsigned int index : indices) {
+    if (entered[index] == 0 || misses - entered[index] + 1 > cache_size) {
+      misses++;
+      entered[index] = misses;
+    }
+  }
+  return (float)misses / (indices.size() / 3);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/*!
+ @brief Reorders the triangles of a mesh for the post transform vertex cache
+ @details Tom Forsyth's linear speed vertex cache optimization. Every vertex
+  is scored by its position in a simulated MESH_CACHE_SIZE entry LRU cache,
+  and by the number of its triangles not yet emitted, and the triangle with
+  the best score among those using the cached vertices is emitted next. Only
+  the order of the triangles changes, the vertices stay the same.
+ @param indices The indices of the triangles, reordered in place
+ @param vertex_count The number of vertices the indices point into
+*/
+void optimize_vertex_cache(std::vector<unsigned int> &indices,
+                           size_t vertex_count);
+
+/*!
+ @brief Orders the vertices of a mesh in the order they are first used
+ @details So that the vertex fetches walk the vertex buffer linearly
+ @param indices The indices of the triangles
+ @param vertex_count The number of vertices the indices point into
+ @return The new position of every vertex, the unused ones placed last
+*/
+std::vector<unsigned int>
+get_fetch_remap(const std::vector<unsigned int> &indices, size_t vertex_count);
+
+/*!
+ @brief Computes the average cache miss ratio of a mesh
+ @details Simulates a FIFO cache, like that of most GPUs
+ @param indices The indices of the triangles
+ @param vertex_count The number of vertices the indices point into
+ @param cache_size The number of entries of the cache
+ @return The number of transformed vertices per triangle, between 0.5 for
+  an ideal order of a regular grid and 3 for no reuse at all
+*/
+float get_acmr(const std::vector<unsigned int> &indices, size_t vertex_count,
+               uint32_t cache_size);
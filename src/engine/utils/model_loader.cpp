@@ -1,5 +1,7 @@
 #include "model_loader.hpp"
 
+#include "../settings.hpp"
+
 #include <stdexcept>
 
 static const std::vector<float> triangle_data = {
@@ -120,8 +122,11 @@ const model *model_loader::get_model(const std::string &key,
   } catch (const std::out_of_range &e) {
 #ifndef STATIC_ASSETS
     model *new_model = new model(key, mesh_index);
+    new_model->generate_lods(MODEL_LODS);
+    new_model->optimize();
     models[key_tuple] = new_model;
     new_model->init();
+    new_model->release_data();
     return new_model;
 #else
     throw std::runtime_error("Model not found");
@@ -29,6 +29,7 @@ public:
   static model_loader &get();
   /*!
    @brief Loads and returns a model, or retrieves it from cache
+   @details Loaded models get MODEL_LODS lower detail levels
    @param key the key under which to access the model
    @param mesh_index the index of the mesh to use
    @return the model
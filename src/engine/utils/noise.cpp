@@ -1,5 +1,17 @@
+#include "noise.hpp"
+
 #include <stdint.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// AVX2 is compiled in regardless of the target, and picked at runtime
+#define NOISE_AVX2
+#endif
+
 /* functions adapted from
 https://github.com/SRombauts/SimplexNoise/blob/master/src/SimplexNoise.cpp
 this means that this code is licensed under MIT and this is ok as long as
@@ -66,14 +78,14 @@ static float grad(int32_t hash, float x, float y) {
                   : 2.0f * v); // and compute the dot product with (x,y).
 }
 
+// Skewing/Unskewing factors for 2D
+static const float F2 = 0.366025403f; // F2 = (sqrt(3) - 1) / 2
+static const float G2 =
+    0.211324865f; // G2 = (3 - sqrt(3)) / 6   = F2 / (1 + 2 * K)
+
 float noise(float x, float y) {
   float n0, n1, n2; // Noise contributions from the three corners
 
-  // Skewing/Unskewing factors for 2D
-  static const float F2 = 0.366025403f; // F2 = (sqrt(3) - 1) / 2
-  static const float G2 =
-      0.211324865f; // G2 = (3 - sqrt(3)) / 6   = F2 / (1 + 2 * K)
-
   // Skew the input space to determine which simplex cell we're in
   const float s = (x + y) * F2; // Hairy factor for 2D
   const float xs = x + s;
@@ -147,3 +159,212 @@ float noise(float x, float y) {
   // The result is scaled to return values in the interval [-1,1].
   return 45.23065f * (n0 + n1 + n2);
 }
+
+/* The vectorized versions below follow noise() operation by operation, in the
+same order, so that they produce exactly the same results. Branches are
+replaced with masks, and the permutation lookups are done per lane. */
+
+#if defined(__SSE2__)
+
+static inline __m128i floor_sse2(__m128 fp) {
+  __m128i i = _mm_cvttps_epi32(fp);
+  // the comparison mask is -1 where we have to round down
+  return _mm_add_epi32(
+      i, _mm_castps_si128(_mm_cmplt_ps(fp, _mm_cvtepi32_ps(i))));
+}
+
+static inline __m128 grad_sse2(__m128i hash, __m128 x, __m128 y) {
+  const __m128i h = _mm_and_si128(hash, _mm_set1_epi32(0x3F));
+  const __m128 low = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+  const __m128 u = _mm_or_ps(_mm_and_ps(low, x), _mm_andnot_ps(low, y));
+  const __m128 v = _mm_or_ps(_mm_and_ps(low, y), _mm_andnot_ps(low, x));
+  // moving the low bits into the sign bit negates the chosen lanes
+  const __m128 u_sign = _mm_castsi128_ps(_mm_slli_epi32(h, 31));
+  const __m128 v_sign = _mm_castsi128_ps(_mm_slli_epi32(h, 30));
+  const __m128 sign = _mm_castsi128_ps(_mm_set1_epi32(INT32_MIN));
+  return _mm_add_ps(
+      _mm_xor_ps(u, _mm_and_ps(u_sign, sign)),
+      _mm_xor_ps(_mm_mul_ps(_mm_set1_ps(2.0f), v), _mm_and_ps(v_sign, sign)));
+}
+
+static inline __m128 corner_sse2(__m128i hash, __m128 x, __m128 y) {
+  __m128 t = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(x, x)),
+                        _mm_mul_ps(y, y));
+  const __m128 inside = _mm_cmpge_ps(t, _mm_setzero_ps());
+  t = _mm_mul_ps(t, t);
+  return _mm_and_ps(inside,
+                    _mm_mul_ps(_mm_mul_ps(t, t), grad_sse2(hash, x, y)));
+}
+
+static void noise_sse2(const float *xs, const float *ys, float *out,
+                       size_t n) {
+  size_t k = 0;
+  for (; k + 4 <= n; k += 4) {
+    const __m128 x = _mm_loadu_ps(xs + k);
+    const __m128 y = _mm_loadu_ps(ys + k);
+    const __m128 s = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(F2));
+    const __m128i i = floor_sse2(_mm_add_ps(x, s));
+    const __m128i j = floor_sse2(_mm_add_ps(y, s));
+
+    const __m128 t =
+        _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(i, j)), _mm_set1_ps(G2));
+    const __m128 x0 = _mm_sub_ps(x, _mm_sub_ps(_mm_cvtepi32_ps(i), t));
+    const __m128 y0 = _mm_sub_ps(y, _mm_sub_ps(_mm_cvtepi32_ps(j), t));
+
+    const __m128 lower = _mm_cmpgt_ps(x0, y0);
+    const __m128 i1 = _mm_and_ps(lower, _mm_set1_ps(1.0f));
+    const __m128 j1 = _mm_andnot_ps(lower, _mm_set1_ps(1.0f));
+    const __m128 x1 = _mm_add_ps(_mm_sub_ps(x0, i1), _mm_set1_ps(G2));
+    const __m128 y1 = _mm_add_ps(_mm_sub_ps(y0, j1), _mm_set1_ps(G2));
+    const __m128 x2 =
+        _mm_add_ps(_mm_sub_ps(x0, _mm_set1_ps(1.0f)), _mm_set1_ps(2.0f * G2));
+    const __m128 y2 =
+        _mm_add_ps(_mm_sub_ps(y0, _mm_set1_ps(1.0f)), _mm_set1_ps(2.0f * G2));
+
+    int32_t ii[4], jj[4], ll[4], gi0[4], gi1[4], gi2[4];
+    _mm_storeu_si128((__m128i *)ii, i);
+    _mm_storeu_si128((__m128i *)jj, j);
+    _mm_storeu_si128((__m128i *)ll, _mm_castps_si128(lower));
+    for (uint8_t l = 0; l < 4; l++) {
+      const int32_t i1 = ll[l] & 1, j1 = 1 - i1;
+      gi0[l] = hash(ii[l] + hash(jj[l]));
+      gi1[l] = hash(ii[l] + i1 + hash(jj[l] + j1));
+      gi2[l] = hash(ii[l] + 1 + hash(jj[l] + 1));
+    }
+
+    const __m128 n0 = corner_sse2(_mm_loadu_si128((__m128i *)gi0), x0, y0);
+    const __m128 n1 = corner_sse2(_mm_loadu_si128((__m128i *)gi1), x1, y1);
+    const __m128 n2 = corner_sse2(_mm_loadu_si128((__m128i *)gi2), x2, y2);
+    _mm_storeu_ps(out + k, _mm_mul_ps(_mm_set1_ps(45.23065f),
+                                      _mm_add_ps(_mm_add_ps(n0, n1), n2)));
+  }
+  for (; k < n; k++) {
+    out[k] = noise(xs[k], ys[k]);
+  }
+}
+
+#endif
+
+#ifdef NOISE_AVX2
+
+/*!
+ @brief The permutation table widened, so that it can be gathered from
+*/
+struct wide_perm {
+  int32_t values[256];
+  wide_perm() {
+    for (uint16_t i = 0; i < 256; i++) {
+      values[i] = perm[i];
+    }
+  }
+};
+
+static const wide_perm perm32;
+
+__attribute__((target("avx2"))) static inline __m256i hash_avx2(__m256i i) {
+  return _mm256_i32gather_epi32(
+      perm32.values, _mm256_and_si256(i, _mm256_set1_epi32(0xFF)), 4);
+}
+
+__attribute__((target("avx2"))) static inline __m256i floor_avx2(__m256 fp) {
+  __m256i i = _mm256_cvttps_epi32(fp);
+  return _mm256_add_epi32(i, _mm256_castps_si256(_mm256_cmp_ps(
+                                 fp, _mm256_cvtepi32_ps(i), _CMP_LT_OQ)));
+}
+
+__attribute__((target("avx2"))) static inline __m256
+grad_avx2(__m256i hash, __m256 x, __m256 y) {
+  const __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(0x3F));
+  const __m256 low =
+      _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+  const __m256 u = _mm256_blendv_ps(y, x, low);
+  const __m256 v = _mm256_blendv_ps(x, y, low);
+  const __m256 u_sign = _mm256_castsi256_ps(_mm256_slli_epi32(h, 31));
+  const __m256 v_sign = _mm256_castsi256_ps(_mm256_slli_epi32(h, 30));
+  const __m256 sign = _mm256_castsi256_ps(_mm256_set1_epi32(INT32_MIN));
+  return _mm256_add_ps(_mm256_xor_ps(u, _mm256_and_ps(u_sign, sign)),
+                       _mm256_xor_ps(_mm256_mul_ps(_mm256_set1_ps(2.0f), v),
+                                     _mm256_and_ps(v_sign, sign)));
+}
+
+__attribute__((target("avx2"))) static inline __m256
+corner_avx2(__m256i hash, __m256 x, __m256 y) {
+  __m256 t = _mm256_sub_ps(
+      _mm256_sub_ps(_mm256_set1_ps(0.5f), _mm256_mul_ps(x, x)),
+      _mm256_mul_ps(y, y));
+  const __m256 inside = _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_GE_OQ);
+  t = _mm256_mul_ps(t, t);
+  return _mm256_and_ps(
+      inside, _mm256_mul_ps(_mm256_mul_ps(t, t), grad_avx2(hash, x, y)));
+}
+
+__attribute__((target("avx2"))) static void
+noise_avx2(const float *xs, const float *ys, float *out, size_t n) {
+  const __m256i one_i = _mm256_set1_epi32(1);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  size_t k = 0;
+  for (; k + 8 <= n; k += 8) {
+    const __m256 x = _mm256_loadu_ps(xs + k);
+    const __m256 y = _mm256_loadu_ps(ys + k);
+    const __m256 s = _mm256_mul_ps(_mm256_add_ps(x, y), _mm256_set1_ps(F2));
+    const __m256i i = floor_avx2(_mm256_add_ps(x, s));
+    const __m256i j = floor_avx2(_mm256_add_ps(y, s));
+
+    const __m256 t = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(i, j)),
+                                   _mm256_set1_ps(G2));
+    const __m256 x0 =
+        _mm256_sub_ps(x, _mm256_sub_ps(_mm256_cvtepi32_ps(i), t));
+    const __m256 y0 =
+        _mm256_sub_ps(y, _mm256_sub_ps(_mm256_cvtepi32_ps(j), t));
+
+    const __m256 lower = _mm256_cmp_ps(x0, y0, _CMP_GT_OQ);
+    const __m256i i1 = _mm256_and_si256(_mm256_castps_si256(lower), one_i);
+    const __m256i j1 = _mm256_sub_epi32(one_i, i1);
+    const __m256 x1 = _mm256_add_ps(
+        _mm256_sub_ps(x0, _mm256_and_ps(lower, one)), _mm256_set1_ps(G2));
+    const __m256 y1 = _mm256_add_ps(
+        _mm256_sub_ps(y0, _mm256_andnot_ps(lower, one)), _mm256_set1_ps(G2));
+    const __m256 x2 =
+        _mm256_add_ps(_mm256_sub_ps(x0, one), _mm256_set1_ps(2.0f * G2));
+    const __m256 y2 =
+        _mm256_add_ps(_mm256_sub_ps(y0, one), _mm256_set1_ps(2.0f * G2));
+
+    const __m256i gi0 = hash_avx2(_mm256_add_epi32(i, hash_avx2(j)));
+    const __m256i gi1 = hash_avx2(_mm256_add_epi32(
+        _mm256_add_epi32(i, i1), hash_avx2(_mm256_add_epi32(j, j1))));
+    const __m256i gi2 = hash_avx2(_mm256_add_epi32(
+        _mm256_add_epi32(i, one_i), hash_avx2(_mm256_add_epi32(j, one_i))));
+
+    const __m256 n0 = corner_avx2(gi0, x0, y0);
+    const __m256 n1 = corner_avx2(gi1, x1, y1);
+    const __m256 n2 = corner_avx2(gi2, x2, y2);
+    _mm256_storeu_ps(out + k,
+                     _mm256_mul_ps(_mm256_set1_ps(45.23065f),
+                                   _mm256_add_ps(_mm256_add_ps(n0, n1), n2)));
+  }
+  // the compiler misses the tail, and dirty upper halves of the registers
+  // slow down all the SSE code that runs after us
+  _mm256_zeroupper();
+  for (; k < n; k++) {
+    out[k] = noise(xs[k], ys[k]);
+  }
+}
+
+#endif
+
+void noise_n(const float *xs, const float *ys, float *out, size_t n) {
+#ifdef NOISE_AVX2
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if (has_avx2) {
+    noise_avx2(xs, ys, out, n);
+    return;
+  }
+#endif
+#if defined(__SSE2__)
+  noise_sse2(xs, ys, out, n);
+#else
+  for (size_t k = 0; k < n; k++) {
+    out[k] = noise(xs[k], ys[k]);
+  }
+#endif
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+
 /*!
  @brief Samples 2D Perlin noise at the given coordinates.
  @param x The x-coordinate of the sample point.
@@ -7,3 +9,14 @@
  @return The noise value at the given coordinates. (z)
 */
 float noise(float x, float y);
+
+/*!
+ @brief Samples 2D Perlin noise at many points at once.
+ @details Uses AVX2 or SSE2 when available, processing 8 or 4 points at a
+  time. The results are bit for bit identical to calling noise() per point.
+ @param xs The x-coordinates of the sample points.
+ @param ys The y-coordinates of the sample points.
+ @param out The array the noise values are written to.
+ @param n The number of sample points.
+*/
+void noise_n(const float *xs, const float *ys, float *out, size_t n);
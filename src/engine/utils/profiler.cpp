@@ -0,0 +1,203 @@
+#include "profiler.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+static double steady_us() {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+static thread_local profile_track *current_track = nullptr;
+
+profiler::profiler() : enabled(false), epoch(steady_us()) {}
+
+profiler::~profiler() {
+  for (profile_track *track : tracks) {
+    delete track;
+  }
+}
+
+profiler &profiler::get() {
+  static profiler instance;
+  return instance;
+}
+
+void profiler::set_enabled(bool enabled) { this->enabled = enabled; }
+
+bool profiler::is_enabled() const { return enabled; }
+
+double profiler::now() const { return steady_us() - epoch; }
+
+profile_track *profiler::get_track() {
+  if (current_track == nullptr) {
+    std::lock_guard<std::mutex> lock(tracks_mutex);
+    current_track = new profile_track();
+    current_track->id = tracks.size();
+    current_track->name = "thread " + std::to_string(tracks.size());
+    current_track->frames.resize(PROFILER_HISTORY);
+    current_track->frame = 0;
+    current_track->gpu_offset = 0;
+    current_track->calibrated = false;
+    tracks.push_back(current_track);
+  }
+  return current_track;
+}
+
+void profiler::name_thread(const std::string &name) {
+  profile_track *track = get_track();
+  std::lock_guard<std::mutex> lock(track->mutex);
+  track->name = name;
+}
+
+std::string profiler::get_thread_name() {
+  profile_track *track = get_track();
+  std::lock_guard<std::mutex> lock(track->mutex);
+  return track->name;
+}
+
+void profiler::end_frame() {
+  if (!enabled) {
+    return;
+  }
+  profile_track *track = get_track();
+  collect(track);
+  std::lock_guard<std::mutex> lock(track->mutex);
+  track->frame++;
+  track->frames[track->frame % PROFILER_HISTORY].clear();
+}
+
+void profiler::collect(profile_track *track) {
+#ifndef WASM
+  for (auto it = track->pending.begin(); it != track->pending.end();) {
+    if (track->frame - it->frame < PROFILER_LATENCY) {
+      break; // the rest is even more recent
+    }
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(it->end, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == GL_FALSE) {
+      break; // we will try again next frame, rather than wait
+    }
+    GLuint64 begin, end;
+    glGetQueryObjectui64v(it->begin, GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(it->end, GL_QUERY_RESULT, &end);
+    if (track->frame - it->frame < PROFILER_HISTORY) {
+      profile_event event = {
+          it->name, ((int64_t)begin - track->gpu_offset) / 1e3 - epoch,
+          (end - begin) / 1e3, true};
+      std::lock_guard<std::mutex> lock(track->mutex);
+      track->frames[it->frame % PROFILER_HISTORY].push_back(event);
+    }
+    track->free_queries.push_back(it->begin);
+    track->free_queries.push_back(it->end);
+    it = track->pending.erase(it);
+  }
+#else
+  (void)track;
+#endif
+}
+
+std::vector<std::vector<profile_event>>
+profiler::get_history(const std::string &name) const {
+  std::vector<std::vector<profile_event>> history;
+  std::lock_guard<std::mutex> lock(tracks_mutex);
+  for (profile_track *track : tracks) {
+    std::lock_guard<std::mutex> track_lock(track->mutex);
+    if (track->name != name) {
+      continue;
+    }
+    uint64_t first =
+        track->frame < PROFILER_HISTORY ? 0 : track->frame - PROFILER_HISTORY + 1;
+    for (uint64_t frame = first; frame <= track->frame; frame++) {
+      history.push_back(track->frames[frame % PROFILER_HISTORY]);
+    }
+  }
+  return history;
+}
+
+void profiler::export_chrome_trace(const std::string &path) const {
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    throw std::runtime_error("Failed to open " + path);
+  }
+  file << "{\"traceEvents\": [";
+  bool first = true;
+  std::lock_guard<std::mutex> lock(tracks_mutex);
+  for (profile_track *track : tracks) {
+    std::lock_guard<std::mutex> track_lock(track->mutex);
+    // GPU events get their own lane under the thread that issued them
+    for (uint8_t gpu = 0; gpu < 2; gpu++) {
+      file << (first ? "" : ",") << "\n{\"name\": \"thread_name\", "
+           << "\"ph\": \"M\", \"pid\": 1, \"tid\": " << track->id * 2 + gpu
+           << ", \"args\": {\"name\": \"" << track->name
+           << (gpu ? " (GPU)" : "") << "\"}}";
+      first = false;
+    }
+    for (const std::vector<profile_event> &events : track->frames) {
+      for (const profile_event &event : events) {
+        file << ",\n{\"name\": \"" << event.name << "\", \"cat\": \""
+             << (event.gpu ? "gpu" : "cpu")
+             << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+             << track->id * 2 + event.gpu << ", \"ts\": " << event.start
+             << ", \"dur\": " << event.duration << "}";
+      }
+    }
+  }
+  file << "\n]}" << std::endl;
+}
+
+profile_scope::profile_scope(const char *name, bool gpu)
+    : name(name), track(nullptr), start(0.0), begin_query(0) {
+  profiler &instance = profiler::get();
+  if (!instance.is_enabled()) {
+    return;
+  }
+  track = instance.get_track();
+#ifndef WASM
+  if (gpu) {
+    if (!track->calibrated) {
+      GLint64 gpu_now;
+      glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+      track->gpu_offset = gpu_now - (int64_t)(steady_us() * 1e3);
+      track->calibrated = true;
+    }
+    if (track->free_queries.empty()) {
+      GLuint queries[2];
+      glGenQueries(2, queries);
+      track->free_queries.push_back(queries[0]);
+      track->free_queries.push_back(queries[1]);
+    }
+    begin_query = track->free_queries.back();
+    track->free_queries.pop_back();
+    glQueryCounter(begin_query, GL_TIMESTAMP);
+  }
+#else
+  (void)gpu;
+#endif
+  start = instance.now();
+}
+
+profile_scope::~profile_scope() {
+  if (track == nullptr) {
+    return;
+  }
+  profile_event event = {name, start, profiler::get().now() - start, false};
+#ifndef WASM
+  if (begin_query != 0) {
+    if (track->free_queries.empty()) {
+      GLuint queries[2];
+      glGenQueries(2, queries);
+      track->free_queries.push_back(queries[0]);
+      track->free_queries.push_back(queries[1]);
+    }
+    GLuint end_query = track->free_queries.back();
+    track->free_queries.pop_back();
+    glQueryCounter(end_query, GL_TIMESTAMP);
+    track->pending.push_back({name, begin_query, end_query, track->frame});
+  }
+#endif
+  std::lock_guard<std::mutex> lock(track->mutex);
+  track->frames[track->frame % PROFILER_HISTORY].push_back(event);
+}
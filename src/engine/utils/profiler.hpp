@@ -0,0 +1,184 @@
+#pragma once
+
+#include "../include.hpp"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*!
+ @brief How many frames of events are kept per thread
+*/
+#define PROFILER_HISTORY 128
+/*!
+ @brief How many frames we wait before reading a GPU timer query
+ @details By then the GPU has long finished the work, so reading the result
+  never stalls
+*/
+#define PROFILER_LATENCY 3
+
+/*!
+ @brief A single timed section of a frame
+*/
+struct profile_event {
+  /*!
+   @brief The name of the section
+  */
+  const char *name;
+  ///@{
+  /*!
+   @brief The start and duration of the section, in microseconds
+   @details Both CPU and GPU events are placed on the same timeline, relative
+    to the creation of the profiler
+  */
+  double start, duration;
+  ///@}
+  /*!
+   @brief Whether the section was timed on the GPU
+  */
+  bool gpu;
+};
+
+/*!
+ @brief A GPU section waiting for its timer queries to finish
+*/
+struct pending_query {
+  const char *name;
+  GLuint begin, end;
+  uint64_t frame;
+};
+
+/*!
+ @brief The events recorded by a single thread
+*/
+struct profile_track {
+  uint32_t id;
+  std::string name;
+  /*!
+   @brief Guards the frame history
+  */
+  std::mutex mutex;
+  /*!
+   @brief Ring of the last PROFILER_HISTORY frames
+  */
+  std::vector<std::vector<profile_event>> frames;
+  /*!
+   @brief The number of frames ended on this thread
+  */
+  uint64_t frame;
+  std::list<pending_query> pending;
+  /*!
+   @brief Timer queries ready for reuse
+  */
+  std::vector<GLuint> free_queries;
+  /*!
+   @brief GPU timestamp minus CPU time, in nanoseconds
+  */
+  int64_t gpu_offset;
+  bool calibrated;
+};
+
+/*!
+ @brief A lightweight frame profiler
+ @details Threads record timed sections, through profile_scope, into a rolling
+  per frame history. GPU sections use timestamp queries, read back a few
+  frames later, so the CPU never waits on the GPU. The history can be
+  inspected, or exported for chrome://tracing. Recording is disabled by
+  default, in which case scopes cost a single flag check.
+*/
+class profiler {
+private:
+  std::atomic<bool> enabled;
+  mutable std::mutex tracks_mutex;
+  std::list<profile_track *> tracks;
+  /*!
+   @brief The point in time all events are relative to
+  */
+  double epoch;
+  profiler();
+  ~profiler();
+  /*!
+   @brief Reads the GPU queries that are old enough
+   @param track The track of the calling thread
+  */
+  void collect(profile_track *track);
+
+public:
+  /*!
+   @brief Retrieves the singleton instance
+   @return the profiler
+  */
+  static profiler &get();
+  /*!
+   @brief Enables or disables recording
+   @param enabled Whether to record
+  */
+  void set_enabled(bool enabled);
+  /*!
+   @brief Checks if recording is enabled
+   @return True if recording is enabled
+  */
+  bool is_enabled() const;
+  /*!
+   @brief Gets the track of the calling thread, creating it if necessary
+   @return The track
+  */
+  profile_track *get_track();
+  /*!
+   @brief Names the calling thread in the exported traces
+   @param name The name of the thread
+  */
+  void name_thread(const std::string &name);
+  /*!
+   @brief Gets the name of the calling thread
+   @return The name given with name_thread, or a generated one
+  */
+  std::string get_thread_name();
+  /*!
+   @brief Gets the current time on the profiler timeline
+   @return The time in microseconds
+  */
+  double now() const;
+  /*!
+   @brief Marks the end of a frame on the calling thread
+   @warning If the thread recorded GPU sections, its OpenGL context has to be
+    current
+  */
+  void end_frame();
+  /*!
+   @brief Gets the recorded history of a thread
+   @param name The name the thread was given with name_thread
+   @return The events, oldest frame first, one vector per frame
+  */
+  std::vector<std::vector<profile_event>>
+  get_history(const std::string &name) const;
+  /*!
+   @brief Exports the recorded history as Chrome trace event JSON
+   @param path The path of the file to write
+  */
+  void export_chrome_trace(const std::string &path) const;
+};
+
+/*!
+ @brief Times the enclosing scope
+ @details Records nothing if the profiler is disabled
+*/
+class profile_scope {
+private:
+  const char *name;
+  profile_track *track;
+  double start;
+  GLuint begin_query;
+
+public:
+  /*!
+   @brief Starts timing a section
+   @param name The name of the section, has to outlive the profiler
+   @param gpu Whether to time the section on the GPU as well
+   @warning GPU timing requires an OpenGL context to be current
+  */
+  profile_scope(const char *name, bool gpu = false);
+  ~profile_scope();
+};
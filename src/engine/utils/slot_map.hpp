@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+/*!
+ @brief Marks the end of the free list of a slot_map
+*/
+#define NO_SLOT UINT32_MAX
+
+/*!
+ @brief A stable reference to a value in a slot_map
+ @details The generation tells apart the values that occupied the same slot
+  over time, so a handle to an erased value never reaches its successor
+*/
+struct slot_handle {
+  uint32_t index;
+  uint32_t generation;
+};
+
+/*!
+ @brief A container with constant time insertion and removal, handing out
+  handles that stay valid until their value is erased
+ @details The values are kept packed, so iterating over them is as fast as
+  over a vector, at the cost of their order, as erasing moves the last value
+  into the gap. The slots map the handles onto the packed values, and the
+  free ones form a list through the same field.
+*/
+template <typename T> class slot_map {
+private:
+  struct slot {
+    /*!
+     @brief The position of the value, or the next free slot
+    */
+    uint32_t target;
+    uint32_t generation;
+  };
+  std::vector<T> values;
+  /*!
+   @brief The slot of every value
+  */
+  std::vector<uint32_t> owners;
+  std::vector<slot> slots;
+  /*!
+   @brief The first free slot, NO_SLOT if there is none
+  */
+  uint32_t free_slot;
+
+public:
+  slot_map();
+  /*!
+   @brief Inserts a value
+   @param value The value to insert
+   @return The handle to the value
+  */
+  slot_handle insert(const T &value);
+  /*!
+   @brief Erases a value
+   @param handle The handle to the value
+   @return False if the value was already erased
+  */
+  bool erase(slot_handle handle);
+  /*!
+   @brief Gets a value
+   @param handle The handle to the value
+   @return The value, or nullptr if it was erased
+  */
+  T *get(slot_handle handle);
+  /*!
+   @brief Gets the number of values
+   @return The number of values
+  */
+  size_t size() const;
+  typename std::vector<T>::const_iterator begin() const;
+  typename std::vector<T>::const_iterator end() const;
+};
+
+template <typename T> inline slot_map<T>::slot_map() : free_slot(NO_SLOT) {}
+
+template <typename T>
+inline slot_handle slot_map<T>::insert(const T &value) {
+  uint32_t index = free_slot;
+  if (index == NO_SLOT) {
+    index = slots.size();
+    slot fresh = {0, 0};
+    slots.push_back(fresh);
+  } else {
+    free_slot = slots[index].target;
+  }
+  slots[index].target = values.size();
+  values.push_back(value);
+  owners.push_back(index);
+  slot_handle handle = {index, slots[index].generation};
+  return handle;
+}
+
+template <typename T> inline bool slot_map<T>::erase(slot_handle handle) {
+  if (get(handle) == nullptr) {
+    return false;
+  }
+  slot &erased = slots[handle.index];
+  // the last value fills the gap
+  uint32_t position = erased.target;
+  if (position != values.size() - 1) {
+    values[position] = std::move(values.back());
+    owners[position] = owners.back();
+    slots[owners[position]].target = position;
+  }
+  values.pop_back();
+  owners.pop_back();
+  erased.generation++;
+  erased.target = free_slot;
+  free_slot = handle.index;
+  return true;
+}
+
+template <typename T> inline T *slot_map<T>::get(slot_handle handle) {
+  if (handle.index >= slots.size() ||
+      slots[handle.index].generation != handle.generation) {
+    return nullptr;
+  }
+  return &values[slots[handle.index].target];
+}
+
+template <typename T> inline size_t slot_map<T>::size() const {
+  return values.size();
+}
+
+template <typename T>
+inline typename std::vector<T>::const_iterator slot_map<T>::begin() const {
+  return values.begin();
+}
+
+template <typename T>
+inline typename std::vector<T>::const_iterator slot_map<T>::end() const {
+  return values.end();
+}
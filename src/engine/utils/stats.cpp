@@ -0,0 +1,59 @@
+#include "stats.hpp"
+
+#include <iostream>
+
+#include "profiler.hpp"
+
+thread_local frame_stats current_stats = {};
+
+static thread_local uint64_t frame_number = 0;
+
+static const char *stat_names[STAT_COUNT] = {"draw calls",
+                                            "triangles",
+                                            "instances",
+                                            "shader binds",
+                                            "texture binds",
+                                            "uniform uploads",
+                                            "buffer upload bytes",
+                                            "culled objects"};
+
+stats::stats() : dump_interval(0) {}
+
+stats &stats::get() {
+  static stats instance;
+  return instance;
+}
+
+const char *stats::get_name(stat_counter counter) {
+  return stat_names[counter];
+}
+
+void stats::end_frame() {
+  std::string name = profiler::get().get_thread_name();
+  std::lock_guard<std::mutex> lock(mutex);
+  last[name] = current_stats;
+  frame_number++;
+  if (dump_interval != 0 && frame_number % dump_interval == 0) {
+    std::cerr << name << ":";
+    for (uint8_t i = 0; i < STAT_COUNT; i++) {
+      std::cerr << (i == 0 ? " " : ", ") << stat_names[i] << " "
+                << current_stats.counters[i];
+    }
+    std::cerr << std::endl;
+  }
+  current_stats = frame_stats();
+}
+
+frame_stats stats::get_last_frame(const std::string &name) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = last.find(name);
+  if (it == last.end()) {
+    return frame_stats();
+  }
+  return it->second;
+}
+
+void stats::set_dump_interval(uint32_t frames) {
+  std::lock_guard<std::mutex> lock(mutex);
+  dump_interval = frames;
+}
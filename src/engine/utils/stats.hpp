@@ -0,0 +1,84 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+
+/*!
+ @brief The things we count every frame
+*/
+enum stat_counter : uint8_t {
+  STAT_DRAW_CALLS,
+  STAT_TRIANGLES,
+  STAT_INSTANCES,
+  STAT_SHADER_BINDS,
+  STAT_TEXTURE_BINDS,
+  STAT_UNIFORM_UPLOADS,
+  STAT_BUFFER_UPLOAD_BYTES,
+  STAT_CULLED_OBJECTS,
+  STAT_COUNT
+};
+
+/*!
+ @brief The counters of a single frame
+*/
+struct frame_stats {
+  uint64_t counters[STAT_COUNT];
+};
+
+/*!
+ @brief The counters of the frame being rendered on this thread
+*/
+extern thread_local frame_stats current_stats;
+
+/*!
+ @brief Per frame statistics of the work submitted to OpenGL
+ @details Counters are kept per thread, as each renderer has its own thread,
+  so counting is just an increment. When a renderer ends a frame the counters
+  are published under the profiler name of its thread, and optionally dumped.
+*/
+class stats {
+private:
+  mutable std::mutex mutex;
+  std::map<std::string, frame_stats> last;
+  uint32_t dump_interval;
+  stats();
+
+public:
+  /*!
+   @brief Retrieves the singleton instance
+   @return the statistics
+  */
+  static stats &get();
+  /*!
+   @brief Adds to a counter of the current frame
+   @param counter The counter to increment
+   @param amount The amount to add
+  */
+  static inline void count(stat_counter counter, uint64_t amount = 1) {
+    current_stats.counters[counter] += amount;
+  }
+  /*!
+   @brief Gets the name of a counter
+   @param counter The counter
+   @return The human readable name
+  */
+  static const char *get_name(stat_counter counter);
+  /*!
+   @brief Publishes the counters of the calling thread, and resets them
+  */
+  void end_frame();
+  /*!
+   @brief Gets the counters of the last finished frame of a thread
+   @param name The profiler name of the thread
+   @return The counters, zeroed if the thread has not finished a frame yet
+  */
+  frame_stats get_last_frame(const std::string &name) const;
+  /*!
+   @brief Sets how often the counters are printed
+   @param frames Every how many frames a thread prints its counters, 0
+    disables printing
+  */
+  void set_dump_interval(uint32_t frames);
+};
@@ -2,12 +2,22 @@
 #include <iostream>
 #include <thread>
 
+#include "engine/utils/profiler.hpp"
+#include "engine/utils/stats.hpp"
 #include "scenes/game.hpp"
 #include "scenes/radar.hpp"
 
 #define WINDOW_NAME "Crawler"
 #define WINDOW_WIDTH 500
 #define WINDOW_HEIGHT 500
+// if set, the profiler is enabled and its trace written to the given path
+#define TRACE_ENV "CRAWLER_TRACE"
+// if set, the frame statistics are printed every given number of frames
+#define STATS_ENV "CRAWLER_STATS"
+// if set to 0, the depth prepass is disabled
+#define PREPASS_ENV "CRAWLER_PREPASS"
+// if set to 0, occlusion culling is disabled
+#define OCCLUSION_ENV "CRAWLER_OCCLUSION"
 
 static void glfw_error_callback(int error, const char *description) {
   fprintf(stderr, "GLFW error: 0x%x, %s\n", error, description);
@@ -53,11 +63,26 @@ int main() {
 
   std::srand(std::time(nullptr));
 
+  const char *trace_path = std::getenv(TRACE_ENV);
+  profiler::get().set_enabled(trace_path != NULL);
+  const char *stats_interval = std::getenv(STATS_ENV);
+  if (stats_interval != NULL) {
+    stats::get().set_dump_interval(std::atoi(stats_interval));
+  }
+
   std::list<boid *> boids;
 
   // a scene is a collection of objects
   game game_scene(boids);
   radar second_scene(boids);
+  const char *prepass = std::getenv(PREPASS_ENV);
+  if (prepass != NULL) {
+    game_scene.set_depth_prepass(std::atoi(prepass) != 0);
+  }
+  const char *occlusion = std::getenv(OCCLUSION_ENV);
+  if (occlusion != NULL) {
+    game_scene.set_occlusion_culling(std::atoi(occlusion) != 0);
+  }
 
   camera main_camera(glm::vec3(0.0f, 0.0f, 0.0f));
 
@@ -90,6 +115,10 @@ int main() {
                   WINDOW_NAME, &mutex);
 #endif
 
+  if (trace_path != NULL) {
+    profiler::get().export_chrome_trace(trace_path);
+  }
+
   glfwTerminate();
   return 0;
 }
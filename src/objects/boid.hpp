@@ -2,7 +2,8 @@
 
 #include "../engine/engine.hpp"
 #include "../engine/utils/model_loader.hpp"
-#include "../physics/entity.hpp"
+
+#include <vector>
 
 #define SEP_SCALE 4.0f
 #define ALI_SCALE 1.0f
@@ -49,13 +50,24 @@ struct boid_species {
   float pref_y;
 };
 
+/*!
+ @brief The component of entities that flock with others
+*/
+struct flock_agent {
+  const boid_species *species;
+};
+
 /*!
  @brief A boid object, a particle that can flock with other boids
+ @details The object only draws the boid, the boid itself is an entity made
+  of a transform, a bounding_box, a rigid_body, a flock_agent and a
+  render_link to the object, moved by update_flocks
 */
-class boid : public object, protected entity {
+class boid : public object {
 public:
   /*!
-   @brief Constructs a boid object
+   @brief Constructs a boid object, along with its entity
+   @param world The registry to create the entity in
    @param tex The texture of the boid
    @param norm The normal map of the boid
    @param xpos The x position of the boid
@@ -63,148 +75,162 @@ public:
    @param zpos The z position of the boid
    @param species The species of the boid
   */
-  boid(const texture *tex, const texture *norm, double xpos, double ypos,
-       double zpos, const boid_species *species);
+  boid(registry &world, const texture *tex, const texture *norm, double xpos,
+       double ypos, double zpos, const boid_species *species);
   ~boid();
-
-  /*!
-   @brief Updates the boid, including physics and flocking
-   @param boids The boids to flock with
-   @param scene The collider to check collisions against
-   @param deltaTime The time since the last update
-  */
-  void update(const std::list<const boid *> &boids, const collider *scene,
-              double deltaTime);
-
   /*!
-   @brief Returns the species id of the boid
-   @return The species id of the boid
+   @brief Gets the entity of the boid
+   @return The entity
   */
-  uint32_t get_species_id() const;
+  entity_id get_entity() const;
 
 private:
-  void evaluate(double deltaTime);
-
-  const boid_species *species;
+  entity_id entity;
 };
 
-inline boid::boid(const texture *tex, const texture *norm, double xpos,
-                  double ypos, double zpos, const boid_species *species)
+inline boid::boid(registry &world, const texture *tex, const texture *norm,
+                  double xpos, double ypos, double zpos,
+                  const boid_species *species)
     : object(model_loader::get().get_triangle(), xpos, ypos, zpos),
-      entity(1.0f, glm::sphericalRand(0.5f)), species(species) {
+      entity(world.create()) {
   this->add_texture(tex, "texture0");
   this->add_texture(norm, "normal0");
   this->set_scale(0.5f);
+  transform place = {get_position()};
+  world.add(entity, place);
+  bounding_box box;
+  get_world_bounds(box.low, box.high);
+  box.low -= place.position;
+  box.high -= place.position;
+  world.add(entity, box);
+  rigid_body body = {1.0f, glm::sphericalRand(0.5f), glm::vec3(0.0f)};
+  world.add(entity, body);
+  flock_agent agent = {species};
+  world.add(entity, agent);
+  render_link link = {this};
+  world.add(entity, link);
 }
 
 inline boid::~boid() {}
 
-inline void boid::update(const std::list<const boid *> &boids,
-                         const collider *scene, double deltaTime) {
+inline entity_id boid::get_entity() const { return entity; }
 
-  glm::vec3 position = this->get_position();
-  // fprintf(stderr, "Position: %f %f %f\n", position.x, position.y,
-  // position.z);
+/*!
+ @brief Steers and moves all the flock agents
+ @details The flock is gathered into packed arrays first, and every agent
+  steers by the state of the others from before the tick, so each agent only
+  writes its own components. The agents bounce off the scene and off the
+  bounds of the flying area.
+ @param world The registry holding the agents
+ @param scene The collider to check collisions against
+ @param delta_time The time since the last update
+*/
+inline void update_flocks(registry &world, const collider *scene,
+                          double delta_time) {
+  component_pool<flock_agent> &agents = world.pool<flock_agent>();
+  size_t count = agents.size();
+  std::vector<transform *> places(count);
+  std::vector<rigid_body *> bodies(count);
+  std::vector<glm::vec3> positions(count), velocities(count);
+  for (size_t i = 0; i < count; i++) {
+    entity_id agent = agents.entity_at(i);
+    places[i] = world.get<transform>(agent);
+    bodies[i] = world.get<rigid_body>(agent);
+    positions[i] = places[i]->position;
+    velocities[i] = bodies[i]->velocity;
+  }
 
-  glm::vec3 steer(0.0f); // steer accumulator
-  {
-    uint32_t count = 0;
-    for (const boid *other : boids) {
-      // sanity check
-      if (other == this) {
+  for (size_t i = 0; i < count; i++) {
+    const boid_species *species = agents.at(i).species;
+    glm::vec3 position = positions[i];
+    glm::vec3 steer(0.0f); // steer accumulator
+    uint32_t neighbours = 0;
+    for (size_t j = 0; j < count; j++) {
+      if (j == i) {
         continue;
       }
-      glm::vec3 diff = position - other->get_position();
+      glm::vec3 diff = position - positions[j];
       float distance = glm::length(diff);
       if (distance == 0.0f) {
-        // fprintf(stderr, "Distance is zero\n");
         continue;
       }
-      if (other->get_species_id() == species->id) { // if species match
+      if (agents.at(j).species->id == species->id) { // if species match
         // we add alignment speed if the boid is close enough
         if (distance < species->ali_dist) {
-          steer += other->get_velocity() * ALI_SCALE;
-          count++;
+          steer += velocities[j] * ALI_SCALE;
+          neighbours++;
         }
         // we add cohesion force if the boid is close enough
         if (distance < species->coh_dist) {
-          steer += other->get_position() * COH_SCALE;
-          count++;
+          steer += positions[j] * COH_SCALE;
+          neighbours++;
         }
       } else {
         distance /= DISLIKE_SCALE;
       }
       if (distance < species->sep_dist) {
         steer += (glm::normalize(diff) / distance) * SEP_SCALE;
-        count++;
+        neighbours++;
       }
 
-      count++;
+      neighbours++;
     }
-    if (count > 0) {
-      steer /= count;
+    if (neighbours > 0) {
+      steer /= neighbours;
       if (glm::length(steer) > 0.0f) {
-        steer = glm::normalize(steer) * species->max_speed - velocity;
+        steer = glm::normalize(steer) * species->max_speed - velocities[i];
         if (glm::length(steer) > MAX_FORCE) {
           steer = glm::normalize(steer) * MAX_FORCE;
         }
-      } else {
-        // fprintf(stderr, "Steer length is zero\n");
       }
     }
-  }
-
-  // custom addition: a preference for a certain y position
-  float pref_y_value = pow(species->pref_y - position.y, 3.f);
-  pref_y_value =
-      glm::clamp(pref_y_value, -1000.0f, 1000.0f); // Clamping the value
-  glm::vec3 pref_y = glm::vec3(0., pref_y_value, 0.) * PREF_Y_SCALE;
 
-  this->apply_force(steer + pref_y);
+    // custom addition: a preference for a certain y position
+    float pref_y_value = pow(species->pref_y - position.y, 3.f);
+    pref_y_value =
+        glm::clamp(pref_y_value, -1000.0f, 1000.0f); // Clamping the value
+    glm::vec3 pref_y = glm::vec3(0., pref_y_value, 0.) * PREF_Y_SCALE;
 
-  // Random perturbation
-  glm::vec3 random_perturbation = glm::sphericalRand(0.1f) * 0.2f;
-  this->apply_force(random_perturbation);
-
-  // Force for centre attraction
-  glm::vec3 center(0.0f, 0.0f, 0.0f);
-  glm::vec3 to_center = center - position;
-  glm::vec3 center_force = glm::normalize(to_center) * 0.1f;
-  this->apply_force(center_force);
-
-  this->evaluate(deltaTime);
+    // random perturbation, and a pull towards the centre
+    glm::vec3 random_perturbation = glm::sphericalRand(0.1f) * 0.2f;
+    glm::vec3 center_force = glm::normalize(-position) * 0.1f;
+    bodies[i]->force += steer + pref_y + random_perturbation + center_force;
+  }
 
-  glm::vec3 translation = velocity * (float)deltaTime;
+  integrate_bodies(world, delta_time);
 
-  glm::vec3 target = position + translation;
+  for (size_t i = 0; i < count; i++) {
+    rigid_body &body = *bodies[i];
+    glm::vec3 position = positions[i];
+    glm::vec3 translation = body.velocity * (float)delta_time;
+    glm::vec3 target = position + translation;
 
-  glm::vec3 bound = get_bounds();
-  glm::vec3 negbound = get_negbounds();
+    // the corners of the box are swept along as well
+    const bounding_box *box = world.get<bounding_box>(agents.entity_at(i));
+    glm::vec3 negbound = position + box->low, bound = position + box->high;
 
-  if (scene->check_line(position, target) ||
-      scene->check_line(bound, bound + translation) ||
-      scene->check_line(negbound, negbound + translation)) {
-    this->velocity = -this->velocity;
-  } else {
+    if (scene->check_line(position, target) ||
+        scene->check_line(bound, bound + translation) ||
+        scene->check_line(negbound, negbound + translation)) {
+      body.velocity = -body.velocity;
+      continue;
+    }
 
     if (target.x <= MIN_X || target.x >= MAX_X) {
-      this->velocity.x = -this->velocity.x;
+      body.velocity.x = -body.velocity.x;
       target.x = glm::clamp(target.x, MIN_X, MAX_X);
     }
 
     if (target.y <= MIN_Y || target.y >= MAX_Y) {
-      this->velocity.y = -this->velocity.y;
+      body.velocity.y = -body.velocity.y;
       target.y = glm::clamp(target.y, MIN_Y, MAX_Y);
     }
 
     if (target.z <= MIN_Z || target.z >= MAX_Z) {
-      this->velocity.z = -this->velocity.z;
+      body.velocity.z = -body.velocity.z;
       target.z = glm::clamp(target.z, MIN_Z, MAX_Z);
     }
 
-    this->set_position(target);
+    places[i]->position = target;
   }
 }
-inline uint32_t boid::get_species_id() const { return species->id; }
-
-inline void boid::evaluate(double deltaTime) { entity::evaluate(deltaTime); }
@@ -17,6 +17,8 @@ public:
   ~grass();
   void render(const camera *target_camera, const shader *current_shader,
               uint32_t tex_off) const;
+  void render_shadow(const shader *current_shader, uint32_t tex_off) const;
+  bool get_world_bounds(glm::vec3 &low, glm::vec3 &high) const;
 
 private:
   const texture *tex;
@@ -31,11 +33,23 @@ inline grass::grass(const texture *tex, const std::vector<glm::vec3> &points)
 
 inline grass::~grass() {}
 
+inline bool grass::get_world_bounds(glm::vec3 &, glm::vec3 &) const {
+  // the instances are spread all over the map, so never worth culling
+  return false;
+}
+
 inline void grass::render(const camera *, const shader *current_shader,
                           uint32_t tex_off) const {
   current_shader->apply_uniform_mat4(get_model_matrix(), "model");
+  // shares the shader of the leaves, without leaving any instances out
+  current_shader->apply_uniform_scalar(0.0f, "cutoffDistance");
   tex->set_active_texture(current_shader, tex_off, "texture0");
   draw();
   glActiveTexture(GL_TEXTURE0 + tex_off);
   glBindTexture(GL_TEXTURE_2D, 0);
 }
+
+inline void grass::render_shadow(const shader *current_shader,
+                                 uint32_t tex_off) const {
+  render(nullptr, current_shader, tex_off);
+}
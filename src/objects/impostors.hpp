@@ -0,0 +1,92 @@
+#pragma once
+
+#include <mutex>
+
+#include "../engine/engine.hpp"
+#include "../engine/utils/model_loader.hpp"
+
+/*!
+ @brief Billboards standing in for distant objects. Rendered through instancing
+ @details Every instance shows one of the variants of an impostor atlas, from
+  the baked view closest to the direction it is seen from, so thousands of
+  them cost about as much as a handful of full objects. The instances near the
+  cutoff center are left out, so that the objects there can be drawn in full.
+*/
+class impostors : public object {
+public:
+  /*!
+   @brief Constructs a new impostors object
+   @param atlas The atlas holding the baked variants
+   @param points The origins of the instances
+  */
+  impostors(const impostor_atlas *atlas, const std::vector<glm::vec3> &points);
+  ~impostors();
+  void render(const camera *target_camera, const shader *current_shader,
+              uint32_t tex_off) const;
+  void begin_frame() const;
+  bool get_world_bounds(glm::vec3 &low, glm::vec3 &high) const;
+  /*!
+   @brief Sets the area the impostors are left out within
+   @details Takes effect from the next frame on, along with the objects being
+    shown and hidden
+   @param center The center of the area
+   @param distance The horizontal radius of the area
+  */
+  void set_cutoff(glm::vec3 center, float distance);
+
+private:
+  const impostor_atlas *atlas;
+  /*!
+   @brief Guards the cutoff set by the game thread
+  */
+  mutable std::mutex cutoff_mutex;
+  glm::vec3 next_center;
+  float next_distance;
+  /*!
+   @brief The cutoff of the current frame
+  */
+  mutable glm::vec3 cutoff_center;
+  mutable float cutoff_distance;
+};
+
+inline impostors::impostors(const impostor_atlas *atlas,
+                            const std::vector<glm::vec3> &points)
+    : object(model_loader::get().get_wall()->get_instanced(points), 0.f, 0.f,
+             0.f),
+      atlas(atlas), next_center(0.0f), next_distance(0.0f),
+      cutoff_center(0.0f), cutoff_distance(0.0f) {}
+
+inline impostors::~impostors() {
+  object_model->deinit();
+  delete object_model;
+}
+
+inline bool impostors::get_world_bounds(glm::vec3 &, glm::vec3 &) const {
+  // the instances are spread all over the map, so never worth culling
+  return false;
+}
+
+inline void impostors::render(const camera *, const shader *current_shader,
+                              uint32_t tex_off) const {
+  current_shader->apply_uniform_vec3(atlas->get_frame(), "impostorFrame");
+  current_shader->apply_uniform(atlas->get_variants(), "impostorVariants");
+  current_shader->apply_uniform_vec3(cutoff_center, "cutoffCenter");
+  current_shader->apply_uniform_scalar(cutoff_distance, "cutoffDistance");
+  atlas->set_active_texture(current_shader, tex_off, "impostorAtlas");
+  draw();
+  glActiveTexture(GL_TEXTURE0 + tex_off);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+inline void impostors::begin_frame() const {
+  object::begin_frame();
+  std::lock_guard<std::mutex> lock(cutoff_mutex);
+  cutoff_center = next_center;
+  cutoff_distance = next_distance;
+}
+
+inline void impostors::set_cutoff(glm::vec3 center, float distance) {
+  std::lock_guard<std::mutex> lock(cutoff_mutex);
+  next_center = center;
+  next_distance = distance;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <mutex>
+
 #include "../engine/engine.hpp"
 #include "../engine/utils/model_loader.hpp"
 #include "../engine/utils/noise.hpp"
@@ -21,33 +23,111 @@ public:
   ~leaves();
   void render(const camera *target_camera, const shader *current_shader,
               uint32_t tex_off) const;
+  /*!
+   @brief Render all the leaves into the cached shadow maps
+   @details The cutoff follows the camera, so the cached maps hold every
+    leaf, same as they hold the hidden trees
+   @param current_shader The shader to render the leaves with
+   @param tex_off The offset to start the textures at
+  */
+  void render_shadow(const shader *current_shader, uint32_t tex_off) const;
+  void begin_frame() const;
+  bool get_world_bounds(glm::vec3 &low, glm::vec3 &high) const;
+  /*!
+   @brief Sets the area the leaves are drawn within
+   @details Takes effect from the next frame on
+   @param center The center of the area
+   @param distance The horizontal radius of the area, or 0 to draw all the
+    leaves
+  */
+  void set_cutoff(glm::vec3 center, float distance);
 
 private:
   const texture *tex;
+  /*!
+   @brief Guards the cutoff set by the game thread
+  */
+  mutable std::mutex cutoff_mutex;
+  glm::vec3 next_center;
+  float next_distance;
+  /*!
+   @brief The cutoff of the current frame
+  */
+  mutable glm::vec3 cutoff_center;
+  mutable float cutoff_distance;
+  /*!
+   @brief Renders the leaves within a given distance of the cutoff center
+   @param current_shader The shader to render the leaves with
+   @param tex_off The offset to start the textures at
+   @param distance The horizontal radius, or 0 to draw all the leaves
+  */
+  void render_within(const shader *current_shader, uint32_t tex_off,
+                     float distance) const;
 };
 
 inline leaves::leaves(const texture *tex, const std::vector<glm::vec3> &points)
     : object(model_loader::get().get_wall()->get_instanced(points), 0.f, 0.f,
              0.f),
-      tex(tex) {}
+      tex(tex), next_center(0.0f), next_distance(0.0f), cutoff_center(0.0f),
+      cutoff_distance(0.0f) {}
 
-inline leaves::~leaves() {}
+inline leaves::~leaves() {
+  // the instanced model is made for, and only used by, this object
+  object_model->deinit();
+  delete object_model;
+}
+
+inline bool leaves::get_world_bounds(glm::vec3 &, glm::vec3 &) const {
+  // the instances are spread all over the map, so never worth culling
+  return false;
+}
 
 inline void leaves::render(const camera *, const shader *current_shader,
                            uint32_t tex_off) const {
+  render_within(current_shader, tex_off, cutoff_distance);
+}
+
+inline void leaves::render_shadow(const shader *current_shader,
+                                  uint32_t tex_off) const {
+  render_within(current_shader, tex_off, 0.0f);
+}
+
+inline void leaves::render_within(const shader *current_shader,
+                                  uint32_t tex_off, float distance) const {
   current_shader->apply_uniform_mat4(get_model_matrix(), "model");
+  current_shader->apply_uniform_vec3(cutoff_center, "cutoffCenter");
+  current_shader->apply_uniform_scalar(distance, "cutoffDistance");
   tex->set_active_texture(current_shader, tex_off, "leafTexture");
   draw();
   glActiveTexture(GL_TEXTURE0 + tex_off);
   glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+inline void leaves::begin_frame() const {
+  object::begin_frame();
+  std::lock_guard<std::mutex> lock(cutoff_mutex);
+  cutoff_center = next_center;
+  cutoff_distance = next_distance;
+}
+
+inline void leaves::set_cutoff(glm::vec3 center, float distance) {
+  std::lock_guard<std::mutex> lock(cutoff_mutex);
+  next_center = center;
+  next_distance = distance;
+}
+
 inline texture *create_random_leaf_texture(uint32_t size,
                                            uint8_t color_variance) {
   uint8_t *leaf_data = new uint8_t[size * size * 4];
   float radius = size / 2;
   glm::vec2 image_center(radius, radius);
+  std::vector<float> xs(size), ys(size), noise_vals(size);
+  for (size_t y = 0; y < size; y++) {
+    ys[y] = y;
+  }
   for (size_t x = 0; x < size; x++) {
+    std::fill(xs.begin(), xs.end(), (float)x);
+    noise_n(xs.data(), ys.data(), noise_vals.data(), size);
     for (size_t y = 0; y < size; y++) {
       size_t i = (x + y * size) * 4;
       float distance = glm::distance(glm::vec2(x, y), image_center);
@@ -59,7 +139,7 @@ inline texture *create_random_leaf_texture(uint32_t size,
       leaf_data[i + 1] =
           (255 - color_variance) + glm::linearRand((uint8_t)0, color_variance);
       leaf_data[i + 2] = 0;
-      float noise_val = noise(x, y) + 1.f * 128.f;
+      float noise_val = noise_vals[y] + 1.f * 128.f;
       leaf_data[i + 3] = (uint8_t)noise_val; // alpha
     }
   }
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <map>
+#include <tuple>
+
 #include "../engine/engine.hpp"
+#include "../engine/utils/collision.hpp"
 #include "../engine/utils/noise.hpp"
+#include "../engine/utils/stats.hpp"
 
 /*!
  @brief The maximum value of the noise
@@ -15,35 +20,145 @@
  @brief The temperature of the noise (how random it is)
 */
 #define NOISE_TEMP 10.f
+/*!
+ @brief The number of samples along a cell of the occluder of a floor
+ @details The occluder stays below the floor drawn at any detail level whose
+  step divides this one
+*/
+#define OCCLUDER_CELL 8
+
+/*!
+ @brief A shared index buffer, drawing a grid at some level of detail
+ @details The grid is drawn as triangle strips, separated by the largest index
+  of the type, for primitive restart
+*/
+struct grid_lod {
+  GLuint buffer;
+  GLsizei count;
+  /*!
+   @brief The type of the indices, GL_UNSIGNED_SHORT if the grid allows for it
+  */
+  GLenum type;
+};
+
+/*!
+ @brief Flags marking the grid edges that border a coarser grid
+*/
+enum grid_side : uint8_t {
+  SIDE_NEG_X = 1,
+  SIDE_POS_X = 2,
+  SIDE_NEG_Z = 4,
+  SIDE_POS_Z = 8,
+};
 
 /*!
  @brief A surface that is generated using Perlin noise
  @details The noise is generated using the noise function in noise.hpp, and then
  altered using the NOISE_MAX and DILLATION constants. Additionally the noise is
  randomly sampled based on the NOISE_TEMP constant. In OpenGL terms it is a
- simple triangle mesh, statically generated.
+ statically generated grid of vertices, drawn with the index buffers of
+ grid_lod_cache::shared.
 */
 class random_floor : public object {
 private:
   glm::vec2 noise_shift;
+  float resolution;
+  ///@{
+  /*!
+   @brief The number of samples along each axis
+  */
+  uint32_t samples_x, samples_z;
+  ///@}
+  /*!
+   @brief The sampled noise, with a ring of samples around the floor
+  */
+  std::vector<float> heights;
+  ///@{
+  /*!
+   @brief The number of occluder grid points along each axis
+  */
+  uint32_t occluder_x, occluder_z;
+  ///@}
+  /*!
+   @brief The heights of the coarse grid the floor occludes with, every
+    OCCLUDER_CELL samples, each the lowest of the samples in the cells around
+    it
+  */
+  std::vector<float> occluder_heights;
   model floor;
-  texture tex, norm;
+  /*!
+   @brief The index buffer to draw with, or nullptr for the full detail one
+  */
+  const grid_lod *lod;
+  /*!
+   @brief Gets the height of the floor at a grid sample
+   @param x The sample index along the x axis, may be one past the floor
+   @param z The sample index along the z axis, may be one past the floor
+   @return The height at the sample
+  */
+  float get_height(int32_t x, int32_t z) const;
 
 public:
   /*!
    @brief Constructs a random floor object
+   @param tex The texture of the floor
+   @param norm The normal map of the floor
+   @param xpos The x position of the floor
+   @param ypos The y position of the floor
+   @param zpos The z position of the floor
+   @param width The width of the floor
+   @param height The height of the floor
+   @param resolution The distance between each sample
+  */
+  random_floor(const texture *tex, const texture *norm, double xpos,
+               double ypos, double zpos, uint32_t width, uint32_t height,
+               float resolution);
+  /*!
+   @brief Constructs a random floor object with a fixed noise shift
+   @details Floors sharing a noise shift, with the shift offset by their
+    position, form a single continuous surface
+   @param tex The texture of the floor
+   @param norm The normal map of the floor
    @param xpos The x position of the floor
    @param ypos The y position of the floor
    @param zpos The z position of the floor
    @param width The width of the floor
    @param height The height of the floor
    @param resolution The distance between each sample
+   @param noise_shift The amount to shift the noise by
+   @note This constructor does not touch the OpenGL context, so it can be used
+    from worker threads. init() has to be called before the floor is rendered
   */
-  random_floor(double xpos, double ypos, double zpos, uint32_t width,
-               uint32_t height, float resolution);
+  random_floor(const texture *tex, const texture *norm, double xpos,
+               double ypos, double zpos, uint32_t width, uint32_t height,
+               float resolution, glm::vec2 noise_shift);
   ~random_floor();
+  /*!
+   @brief Initializes the floor model within the OpenGL context
+  */
+  void init();
+  /*!
+   @brief Undoes the OpenGL initialization of the floor model
+  */
+  void deinit() const;
+  /*!
+   @brief Sets the level of detail the floor should be drawn with
+   @param lod The shared index buffer to draw with, or nullptr to draw the
+    floor at full detail
+  */
+  void set_lod(const grid_lod *lod);
+  /*!
+   @brief Gets the level of detail the floor is drawn with
+   @return The shared index buffer, or nullptr for the full detail
+  */
+  const grid_lod *get_grid_lod() const;
+  void draw() const override;
+  void draw_occluders(occlusion_buffer &buffer) const override;
   /*!
    @brief Sample the noise at a given point
+   @details Within the floor the height is interpolated over the triangles
+    of the full detail surface, so it agrees with check_line_floor and what
+    is drawn, outside of it the noise is sampled directly
    @param x The x coordinate of the point
    @param y The y coordinate of the point
    @return The noise value at the given point
@@ -57,11 +172,16 @@ public:
   bool check_point_floor(glm::vec3 point) const;
   /*!
    @brief Check if a line intersects the floor
+   @details Walks the grid cells under the line, testing it against the
+    triangles of each, so the cost is proportional to the cells crossed
    @param a The start of the line
    @param b The end of the line
-   @return True if the line intersects the floor, false otherwise
+   @param hit If not nullptr, set to the first point where the line hits the
+    floor
+   @return True if the line intersects the floor, or starts below it
   */
-  bool check_line_floor(glm::vec3 a, glm::vec3 b) const;
+  bool check_line_floor(glm::vec3 a, glm::vec3 b,
+                        glm::vec3 *hit = nullptr) const;
 };
 
 /*!
@@ -77,40 +197,86 @@ static inline float sample_noise(float x, float y) {
 }
 
 /*!
- @brief Generates the data for the floor, sampling the noise at each point
- @param width The width of the floor
- @param height The height of the floor
+ @brief Sample the noise at many points at once
+ @param xs The x coordinates of the points, scaled in place
+ @param ys The y coordinates of the points, scaled in place
+ @param out The array the noise values are written to
+ @param n The number of points
+ @note Gives the same results as sample_noise, but vectorized
+*/
+static inline void sample_noise_n(float *xs, float *ys, float *out, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    xs[i] *= DILLATION;
+    ys[i] *= DILLATION;
+  }
+  noise_n(xs, ys, out, n);
+  for (size_t i = 0; i < n; i++) {
+    out[i] *= NOISE_MAX;
+  }
+}
+
+/*!
+ @brief Samples the noise over the floor grid
+ @details The grid has an additional ring of samples around it, so that the
+  normals at the edges can be computed from the grid alone
+ @param width The number of samples along the x axis
+ @param height The number of samples along the z axis
  @param resolution The distance between each sample
  @param noise_shift The amount to shift the noise by
+ @return (width + 2) * (height + 2) heights, column by column
+*/
+static inline std::vector<float> generate_heights(uint32_t width,
+                                                  uint32_t height,
+                                                  float resolution,
+                                                  glm::vec2 noise_shift) {
+  size_t count = (size_t)(width + 2) * (height + 2);
+  // the coordinates are scratch space, kept by every worker between chunks
+  static thread_local std::vector<float> xs, ys;
+  xs.resize(count);
+  ys.resize(count);
+  std::vector<float> heights(count);
+  for (uint32_t x = 0; x < width + 2; x++) {
+    for (uint32_t y = 0; y < height + 2; y++) {
+      size_t i = x * (height + 2) + y;
+      xs[i] = (((int32_t)x - 1) * resolution) + noise_shift.x;
+      ys[i] = (((int32_t)y - 1) * resolution) + noise_shift.y;
+    }
+  }
+  sample_noise_n(xs.data(), ys.data(), heights.data(), count);
+  return heights;
+}
+
+/*!
+ @brief Generates the data for the floor from its heightfield
+ @param width The number of samples along the x axis
+ @param height The number of samples along the z axis
+ @param resolution The distance between each sample
+ @param heights The heightfield, as returned by generate_heights
  @return A vector of floats representing the points of the floor
 */
-static inline std::vector<float> generate_data(uint32_t width, uint32_t height,
-                                               float resolution,
-                                               glm::vec2 noise_shift) {
+static inline std::vector<float>
+generate_data(uint32_t width, uint32_t height, float resolution,
+              const std::vector<float> &heights) {
   std::vector<float> points;
-  for (uint32_t x = 0; x < width / resolution; x++) {
-    for (uint32_t y = 0; y < height / resolution; y++) {
+  points.reserve((size_t)width * height * MODEL_LINE_SIZE);
+  auto sample = [&](int32_t x, int32_t y) {
+    return heights[(x + 1) * (height + 2) + y + 1];
+  };
+  for (uint32_t x = 0; x < width; x++) {
+    for (uint32_t y = 0; y < height; y++) {
       points.push_back(x * resolution);
-      points.push_back(sample_noise((x * resolution) + noise_shift.x,
-                                    (y * resolution) + noise_shift.y));
+      points.push_back(sample(x, y));
       points.push_back(y * resolution);
       // texture coordinates
       points.push_back(x * resolution);
       points.push_back(y * resolution);
       // normals
       // https://stackoverflow.com/a/13983431/12520385 - simplified normal calc
-      float height_l =
-          sample_noise((x * resolution) - resolution + noise_shift.x,
-                       (y * resolution) + noise_shift.y);
-      float height_r =
-          sample_noise((x * resolution) + resolution + noise_shift.x,
-                       (y * resolution) + noise_shift.y);
-      float height_d =
-          sample_noise((x * resolution) + noise_shift.x,
-                       (y * resolution) - resolution + noise_shift.y);
-      float height_u =
-          sample_noise((x * resolution) + noise_shift.x,
-                       (y * resolution) + resolution + noise_shift.y);
+      // the neighbours come from the grid, the border ring covers the edges
+      float height_l = sample((int32_t)x - 1, y);
+      float height_r = sample(x + 1, y);
+      float height_d = sample(x, (int32_t)y - 1);
+      float height_u = sample(x, y + 1);
       glm::vec3 normal = glm::normalize(
           glm::vec3(height_l - height_r, 2.0f, height_d - height_u));
       points.push_back(normal.x);
@@ -134,67 +300,344 @@ static inline std::vector<float> generate_data(uint32_t width, uint32_t height,
 }
 
 /*!
- @brief Generates the indices for the floor
- @param width The width of the floor
- @param height The height of the floor
- @return A vector of unsigned ints representing the indices of the floor
- @note This is a simple triangle mesh with 2 triangles per square
+ @brief Marks the end of a triangle strip in the grid indices
+ @details Narrowed to 16 bits it still is the largest index, the one WebGL
+  always restarts at
 */
-static inline std::vector<unsigned int> generate_indices(uint32_t width,
-                                                         uint32_t height) {
+#define GRID_RESTART 0xFFFFFFFFu
+
+/*!
+ @brief Generates the indices for the floor at some level of detail
+ @details Every step-th sample is used, in a triangle strip per row of cells
+  along the x axis, each cell split into the same two triangles at any step.
+  Along the edges marked in stitch every other edge sample is snapped onto its
+  neighbour, so that the edge matches a grid with twice the step, and no
+  cracks appear between them. The triangles collapsed in the process are left
+  degenerate, for the rasterizer to skip.
+ @param width The number of samples along the x axis
+ @param height The number of samples along the z axis
+ @param step The distance between used samples, (width - 1) and (height - 1)
+  have to be divisible by the step, and by twice the step when stitching
+ @param stitch The grid_side flags of the edges to stitch
+ @return The indices of the strips, separated by GRID_RESTART
+*/
+static inline std::vector<unsigned int>
+generate_lod_indices(uint32_t width, uint32_t height, uint32_t step,
+                     uint8_t stitch) {
+  auto index = [=](uint32_t x, uint32_t y) -> unsigned int {
+    if (((x == 0 && (stitch & SIDE_NEG_X)) ||
+         (x == width - 1 && (stitch & SIDE_POS_X))) &&
+        (y / step) % 2 == 1) {
+      y -= step;
+    }
+    if (((y == 0 && (stitch & SIDE_NEG_Z)) ||
+         (y == height - 1 && (stitch & SIDE_POS_Z))) &&
+        (x / step) % 2 == 1) {
+      x -= step;
+    }
+    return x * height + y;
+  };
   std::vector<unsigned int> indices;
-  for (uint32_t x = 0; x < width - 1; x++) {
-    for (uint32_t y = 0; y < height - 1; y++) {
-      indices.push_back(x * height + y);
-      indices.push_back(x * height + y + 1);
-      indices.push_back((x + 1) * height + y);
-      indices.push_back((x + 1) * height + y);
-      indices.push_back(x * height + y + 1);
-      indices.push_back((x + 1) * height + y + 1);
+  indices.reserve(((height - 1) / step) * (((width - 1) / step + 1) * 2 + 1));
+  for (uint32_t y = 0; y + step < height; y += step) {
+    if (y != 0) {
+      indices.push_back(GRID_RESTART);
+    }
+    // every cell makes the triangles (x, y) (x, y + 1) (x + 1, y) and
+    // (x + 1, y) (x, y + 1) (x + 1, y + 1)
+    for (uint32_t x = 0; x < width; x += step) {
+      indices.push_back(index(x, y));
+      indices.push_back(index(x, y + step));
     }
   }
   return indices;
 }
 
-inline random_floor::random_floor(double xpos, double ypos, double zpos,
+/*!
+ @brief Lazily built index buffers, shared between grids of the same size
+ @details The buffers only depend on the grid dimensions, the level of detail
+  and the stitched edges, so a handful of them can serve any number of floors
+*/
+class grid_lod_cache {
+private:
+  std::map<std::tuple<uint32_t, uint32_t, uint8_t, uint8_t>, grid_lod> buffers;
+
+public:
+  /*!
+   @brief Gets the cache shared by all the floors
+   @return The cache
+  */
+  static grid_lod_cache &shared();
+  /*!
+   @brief Gets the index buffer for a grid, creating it if necessary
+   @param width The number of samples along the x axis
+   @param height The number of samples along the z axis
+   @param lod The level of detail, with every 2^lod-th sample used
+   @param stitch The grid_side flags of the edges bordering a coarser grid
+   @return The shared index buffer
+   @warning Has to be called from the thread holding the OpenGL context
+  */
+  const grid_lod *get(uint32_t width, uint32_t height, uint8_t lod,
+                      uint8_t stitch);
+  /*!
+   @brief Deletes all the index buffers
+   @details The grids that were handed the buffers can't be drawn afterwards
+   @warning Has to be called from the thread holding the OpenGL context
+  */
+  void clear();
+};
+
+/*!
+ @brief Builds a coarse grid that lies below a heightfield
+ @details Every point of the grid takes the lowest sample of the cells around
+  it, so the triangles between the points never rise above the samples they
+  span
+ @param heights The heightfield, as returned by generate_heights
+ @param width The number of samples along the x axis
+ @param height The number of samples along the z axis
+ @param cell The number of samples along a cell of the grid
+ @param points_x Set to the number of grid points along the x axis
+ @param points_z Set to the number of grid points along the z axis
+ @return The heights of the grid points, column by column
+*/
+static inline std::vector<float>
+generate_occluder_heights(const std::vector<float> &heights, uint32_t width,
+                          uint32_t height, uint32_t cell, uint32_t &points_x,
+                          uint32_t &points_z) {
+  points_x = (width + cell - 2) / cell + 1;
+  points_z = (height + cell - 2) / cell + 1;
+  std::vector<float> occluder;
+  occluder.reserve((size_t)points_x * points_z);
+  for (uint32_t x = 0; x < points_x; x++) {
+    uint32_t center_x = std::min(x * cell, width - 1);
+    for (uint32_t z = 0; z < points_z; z++) {
+      uint32_t center_z = std::min(z * cell, height - 1);
+      float lowest = std::numeric_limits<float>::infinity();
+      for (uint32_t i = center_x - std::min(center_x, cell);
+           i <= std::min(center_x + cell, width - 1); i++) {
+        for (uint32_t j = center_z - std::min(center_z, cell);
+             j <= std::min(center_z + cell, height - 1); j++) {
+          lowest = std::min(lowest, heights[(i + 1) * (height + 2) + j + 1]);
+        }
+      }
+      occluder.push_back(lowest);
+    }
+  }
+  return occluder;
+}
+
+// one more sample than cells, so that the floor spans the whole width
+#define FLOOR_SAMPLES(size, resolution) ((uint32_t)((size) / (resolution)) + 1)
+
+inline random_floor::random_floor(const texture *tex, const texture *norm,
+                                  double xpos, double ypos, double zpos,
                                   uint32_t width, uint32_t height,
                                   float resolution)
-    : object(&floor, xpos, ypos, zpos),
-      noise_shift(glm::linearRand(0.f, NOISE_TEMP),
-                  glm::linearRand(0.f, NOISE_TEMP)),
-      floor(generate_data(width, height, resolution, noise_shift),
-            generate_indices(width / resolution, height / resolution),
-            glm::vec3(width / resolution, NOISE_MAX, height / resolution),
-            glm::vec3(0.0)),
-      tex(TEXTURE_PATH("grass.jpg")), norm(TEXTURE_PATH("grass_normal.png")) {
-  floor.init();
-  this->add_texture(&tex, "texture0");
-  this->add_texture(&norm, "normal0");
+    : random_floor(tex, norm, xpos, ypos, zpos, width, height, resolution,
+                   glm::vec2(glm::linearRand(0.f, NOISE_TEMP),
+                             glm::linearRand(0.f, NOISE_TEMP))) {
+  init();
+}
+
+inline random_floor::random_floor(const texture *tex, const texture *norm,
+                                  double xpos, double ypos, double zpos,
+                                  uint32_t width, uint32_t height,
+                                  float resolution, glm::vec2 noise_shift)
+    : object(&floor, xpos, ypos, zpos), noise_shift(noise_shift),
+      resolution(resolution), samples_x(FLOOR_SAMPLES(width, resolution)),
+      samples_z(FLOOR_SAMPLES(height, resolution)),
+      heights(generate_heights(samples_x, samples_z, resolution, noise_shift)),
+      occluder_heights(generate_occluder_heights(heights, samples_x, samples_z,
+                                                 OCCLUDER_CELL, occluder_x,
+                                                 occluder_z)),
+      floor(generate_data(samples_x, samples_z, resolution, heights),
+            std::vector<unsigned int>(),
+            glm::vec3(width, NOISE_MAX, height),
+            glm::vec3(0.0, -NOISE_MAX, 0.0)),
+      lod(nullptr) {
+  this->add_texture(tex, "texture0");
+  this->add_texture(norm, "normal0");
 }
 
 inline random_floor::~random_floor() {}
 
+inline void random_floor::init() {
+  floor.init();
+  // the heightfield answers all the queries, so the vertices aren't needed
+  floor.release_data();
+}
+
+inline void random_floor::deinit() const { floor.deinit(); }
+
+inline void random_floor::set_lod(const grid_lod *lod) { this->lod = lod; }
+
+inline const grid_lod *random_floor::get_grid_lod() const { return lod; }
+
+inline void random_floor::draw() const {
+  const grid_lod *current =
+      lod != nullptr ? lod
+                     : grid_lod_cache::shared().get(samples_x, samples_z, 0, 0);
+#ifndef WASM
+  // WebGL always restarts, at the largest index of the type
+  glEnable(GL_PRIMITIVE_RESTART);
+  glPrimitiveRestartIndex(current->type == GL_UNSIGNED_SHORT ? 0xFFFF
+                                                             : GRID_RESTART);
+#endif
+  floor.draw_indices(current->buffer, current->count, current->type,
+                     GL_TRIANGLE_STRIP);
+#ifndef WASM
+  glDisable(GL_PRIMITIVE_RESTART);
+#endif
+}
+
+inline void random_floor::draw_occluders(occlusion_buffer &buffer) const {
+  glm::vec3 position = get_position();
+  auto point = [&](uint32_t x, uint32_t z) {
+    return position +
+           glm::vec3(std::min(x * OCCLUDER_CELL, samples_x - 1) * resolution,
+                     occluder_heights[x * occluder_z + z],
+                     std::min(z * OCCLUDER_CELL, samples_z - 1) * resolution);
+  };
+  for (uint32_t x = 0; x + 1 < occluder_x; x++) {
+    for (uint32_t z = 0; z + 1 < occluder_z; z++) {
+      glm::vec3 v00 = point(x, z), v01 = point(x, z + 1),
+                v10 = point(x + 1, z), v11 = point(x + 1, z + 1);
+      buffer.draw_triangle(v00, v01, v10);
+      buffer.draw_triangle(v10, v01, v11);
+    }
+  }
+}
+
+inline grid_lod_cache &grid_lod_cache::shared() {
+  static grid_lod_cache cache;
+  return cache;
+}
+
+inline const grid_lod *grid_lod_cache::get(uint32_t width, uint32_t height,
+                                           uint8_t lod, uint8_t stitch) {
+  auto key = std::make_tuple(width, height, lod, stitch);
+  auto it = buffers.find(key);
+  if (it != buffers.end()) {
+    return &it->second;
+  }
+  std::vector<unsigned int> indices =
+      generate_lod_indices(width, height, 1 << lod, stitch);
+  grid_lod &entry = buffers[key];
+  entry.count = indices.size();
+  // the largest index has to stay free, for the restarts
+  entry.type = (uint64_t)width * height < 0xFFFF ? GL_UNSIGNED_SHORT
+                                                 : GL_UNSIGNED_INT;
+  glGenBuffers(1, &entry.buffer);
+  // the element array binding belongs to whatever VAO is bound, so we upload
+  // through a binding point with no such side effects
+  glBindBuffer(GL_COPY_WRITE_BUFFER, entry.buffer);
+  if (entry.type == GL_UNSIGNED_SHORT) {
+    // GRID_RESTART narrows to the 16 bit restart index
+    std::vector<uint16_t> narrow(indices.begin(), indices.end());
+    glBufferData(GL_COPY_WRITE_BUFFER, narrow.size() * sizeof(uint16_t),
+                 narrow.data(), GL_STATIC_DRAW);
+    stats::count(STAT_BUFFER_UPLOAD_BYTES, narrow.size() * sizeof(uint16_t));
+  } else {
+    glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(unsigned int),
+                 indices.data(), GL_STATIC_DRAW);
+    stats::count(STAT_BUFFER_UPLOAD_BYTES,
+                 indices.size() * sizeof(unsigned int));
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  return &entry;
+}
+
+inline void grid_lod_cache::clear() {
+  for (auto &pair : buffers) {
+    glDeleteBuffers(1, &pair.second.buffer);
+  }
+  buffers.clear();
+}
+
+inline float random_floor::get_height(int32_t x, int32_t z) const {
+  return heights[(x + 1) * (samples_z + 2) + z + 1];
+}
+
 inline float random_floor::sample_noise(float x, float y) const {
   glm::vec3 position = get_position();
-  return ::sample_noise(x + noise_shift.x - position.x,
-                        y + noise_shift.y - position.z);
+  float grid_x = (x - position.x) / resolution;
+  float grid_z = (y - position.z) / resolution;
+  if (!(grid_x >= 0.0f && grid_z >= 0.0f && grid_x <= samples_x - 1 &&
+        grid_z <= samples_z - 1)) {
+    return ::sample_noise(x + noise_shift.x - position.x,
+                          y + noise_shift.y - position.z);
+  }
+  int32_t cell_x = std::min((int32_t)grid_x, (int32_t)samples_x - 2);
+  int32_t cell_z = std::min((int32_t)grid_z, (int32_t)samples_z - 2);
+  float fx = grid_x - cell_x, fz = grid_z - cell_z;
+  // interpolated over the same two triangles generate_lod_indices makes of
+  // the cell, split along the diagonal from (x + 1, z) to (x, z + 1)
+  float h01 = get_height(cell_x, cell_z + 1);
+  float h10 = get_height(cell_x + 1, cell_z);
+  if (fx + fz <= 1.0f) {
+    float h00 = get_height(cell_x, cell_z);
+    return h00 + (h10 - h00) * fx + (h01 - h00) * fz;
+  }
+  float h11 = get_height(cell_x + 1, cell_z + 1);
+  return h11 + (h01 - h11) * (1.0f - fx) + (h10 - h11) * (1.0f - fz);
 }
 
 inline bool random_floor::check_point_floor(glm::vec3 point) const {
   return point.y < sample_noise(point.x, point.z);
 }
 
-inline bool random_floor::check_line_floor(glm::vec3 a, glm::vec3 b) const {
-  if (!object::check_line(a, b)) {
-    return false;
+inline bool random_floor::check_line_floor(glm::vec3 a, glm::vec3 b,
+                                           glm::vec3 *hit) const {
+  if (check_point_floor(a)) {
+    if (hit != nullptr) {
+      *hit = a;
+    }
+    return true;
   }
-  glm::vec3 direction = b - a;
-  float distance = glm::length(direction);
-  glm::vec3 step = direction / distance;
-  for (float i = 0; i < distance; i += 0.1f) {
-    if (check_point(a + step * i)) {
-      return true;
+  glm::vec3 position = get_position();
+  // the line in grid units
+  glm::vec2 start = glm::vec2(a.x - position.x, a.z - position.z) / resolution;
+  glm::vec2 end = glm::vec2(b.x - position.x, b.z - position.z) / resolution;
+  glm::vec2 direction = end - start;
+  // clip the line to the grid
+  float enter = 0.0f, exit = 1.0f;
+  auto clip = [&](float from, float delta, float upper) {
+    if (delta == 0.0f) {
+      return from >= 0.0f && from <= upper;
     }
+    float t0 = -from / delta, t1 = (upper - from) / delta;
+    enter = std::max(enter, std::min(t0, t1));
+    exit = std::min(exit, std::max(t0, t1));
+    return enter <= exit;
+  };
+  if (!clip(start.x, direction.x, samples_x - 1) ||
+      !clip(start.y, direction.y, samples_z - 1)) {
+    return false;
+  }
+  auto vertex = [&](int32_t x, int32_t z) {
+    return position +
+           glm::vec3(x * resolution, get_height(x, z), z * resolution);
+  };
+  float closest = std::numeric_limits<float>::infinity();
+  bool found = traverse_grid(
+      start + direction * enter, start + direction * exit,
+      [&](int32_t x, int32_t z, float, float) {
+        x = std::max(std::min(x, (int32_t)samples_x - 2), 0);
+        z = std::max(std::min(z, (int32_t)samples_z - 2), 0);
+        // the same two triangles generate_lod_indices makes of the cell
+        glm::vec3 v00 = vertex(x, z), v01 = vertex(x, z + 1),
+                  v10 = vertex(x + 1, z), v11 = vertex(x + 1, z + 1);
+        float t;
+        if (check_line_triangle(a, b, v00, v01, v10, t)) {
+          closest = std::min(closest, t);
+        }
+        if (check_line_triangle(a, b, v10, v01, v11, t)) {
+          closest = std::min(closest, t);
+        }
+        return closest <= 1.0f;
+      });
+  if (found && hit != nullptr) {
+    *hit = a + (b - a) * closest;
   }
-  return false;
+  return found;
 }
@@ -0,0 +1,434 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "random_floor.hpp"
+
+/*!
+ @brief The side length of a single terrain chunk
+*/
+#define CHUNK_SIZE 32
+/*!
+ @brief The distance between samples within a chunk
+*/
+#define CHUNK_RESOLUTION 0.5f
+/*!
+ @brief How many chunks are kept loaded around the camera in each direction
+*/
+#define CHUNK_RADIUS 3
+/*!
+ @brief How many generated chunks can be uploaded to the GPU within one frame
+*/
+#define CHUNK_UPLOADS 2
+/*!
+ @brief The number of threads generating chunks
+*/
+#define CHUNK_WORKERS 2
+/*!
+ @brief The number of detail levels a chunk can be drawn at
+ @details Each level uses every other sample of the previous one, so
+  (CHUNK_SIZE / CHUNK_RESOLUTION) has to be divisible by 2^TERRAIN_LODS
+*/
+#define TERRAIN_LODS 4
+/*!
+ @brief The distance from the camera after which a chunk drops a detail level
+ @details Has to be at least CHUNK_SIZE, so that neighbouring chunks never
+  differ by more than a single level
+*/
+#define TERRAIN_LOD_DISTANCE 40.f
+
+/*!
+ @brief The coordinates of a chunk on the chunk grid
+*/
+typedef std::pair<int32_t, int32_t> chunk_coord;
+
+/*!
+ @brief An effectively unbounded surface, streamed in chunks around a point
+ @details The terrain is split into square random_floor chunks, all sharing a
+ single noise shift, so that together they form one continuous surface. Chunks
+ are generated on worker threads, uploaded to the GPU a few at a time by the
+ render thread, and evicted once they fall out of CHUNK_RADIUS. This way the
+ memory footprint stays constant no matter how far the camera travels.
+ Distant chunks are drawn at lower detail (geomipmapping), using index buffers
+ shared between all chunks, with the edges bordering coarser chunks stitched
+ to avoid cracks.
+*/
+class terrain : public object {
+private:
+  glm::vec2 noise_shift;
+  const texture *tex, *norm;
+  /*!
+   @brief Guards everything shared between the game, worker and render
+    threads
+  */
+  mutable std::mutex chunk_mutex;
+  std::condition_variable job_available;
+  /*!
+   @brief The chunks that should currently be loaded
+  */
+  std::set<chunk_coord> wanted;
+  /*!
+   @brief The chunks waiting to be generated
+  */
+  mutable std::deque<chunk_coord> jobs;
+  /*!
+   @brief Chunks that have been generated, but not uploaded yet
+  */
+  mutable std::deque<std::pair<chunk_coord, random_floor *>> ready;
+  /*!
+   @brief Chunks that have been uploaded, only ever modified by the render
+    thread
+  */
+  mutable std::map<chunk_coord, random_floor *> chunks;
+  /*!
+   @brief Changes whenever a chunk is loaded, evicted or changes its level
+  */
+  mutable uint32_t revision;
+  chunk_coord center;
+  /*!
+   @brief The point the detail levels are computed relative to
+   @details Set by the game thread, and latched into the levels of the loaded
+    chunks once per frame
+  */
+  glm::vec3 focus;
+  bool centered, stopping;
+  std::vector<std::thread> workers;
+  /*!
+   @brief The worker thread loop
+  */
+  void work();
+  /*!
+   @brief Generates the chunk at given coordinates
+   @param coord The coordinates of the chunk
+   @return The generated, uninitialized chunk
+  */
+  random_floor *generate(chunk_coord coord) const;
+  /*!
+   @brief Picks the detail level for a chunk
+   @param coord The coordinates of the chunk
+   @param focus The point the chunk is viewed from
+   @return The detail level, 0 being the full detail
+  */
+  static uint8_t get_lod(chunk_coord coord, glm::vec3 focus);
+
+public:
+  /*!
+   @brief Constructs a new terrain, and starts the worker threads
+   @param tex The texture of the terrain
+   @param norm The normal map of the terrain
+  */
+  terrain(const texture *tex, const texture *norm);
+  ~terrain();
+  /*!
+   @brief Moves the loaded area, requesting and evicting chunks as necessary
+   @param position The point around which the chunks should be loaded
+  */
+  void update(glm::vec3 position);
+  /*!
+   @brief Undoes the OpenGL initialization of the loaded chunks
+   @warning Has to be called from the thread holding the OpenGL context,
+    before it is destroyed
+  */
+  void deinit() const;
+  void render(const camera *target_camera, const shader *current_shader,
+              uint32_t tex_off) const;
+  void render_shadow(const shader *current_shader, uint32_t tex_off) const;
+  /*!
+   @brief Uploads generated chunks, drops the evicted ones, and picks the
+    detail level of each loaded chunk
+   @details At most CHUNK_UPLOADS chunks are uploaded, as this runs once per
+    frame. The chunks and their levels stay as they are until the next frame,
+    so that every pass draws the same surface
+  */
+  void begin_frame() const;
+  uint32_t get_revision() const;
+  /*!
+   @brief Draws the coarse occluders of the loaded chunks
+   @param buffer The buffer to draw the occluders into
+   @warning Has to be called from the thread holding the OpenGL context
+  */
+  void draw_occluders(occlusion_buffer &buffer) const;
+  /*!
+   @brief Sample the terrain height at a given point
+   @details Uses the heightfield of the loaded chunk, if there is one
+   @param x The x coordinate of the point
+   @param y The z coordinate of the point
+   @return The height of the terrain at the given point
+  */
+  float sample_noise(float x, float y) const;
+  /*!
+   @brief Check if a point is below the terrain
+   @param point The point to check
+   @return True if the point is below the terrain
+  */
+  bool check_point(glm::vec3 point) const;
+  /*!
+   @brief Check if a line intersects the terrain
+   @param a The start of the line
+   @param b The end of the line
+   @return True if the line intersects the terrain
+  */
+  bool check_line(glm::vec3 a, glm::vec3 b) const;
+  /*!
+   @brief Check if a line intersects the terrain
+   @details Walks the chunks under the line, intersecting it exactly with the
+    loaded ones, and sampling the noise along it in the rest
+   @param a The start of the line
+   @param b The end of the line
+   @param hit If not nullptr, set to the first point where the line hits the
+    terrain
+   @return True if the line intersects the terrain
+  */
+  bool check_line(glm::vec3 a, glm::vec3 b, glm::vec3 *hit) const;
+};
+
+/*!
+ @brief Gets the coordinates of the chunk containing a point
+ @param x The x coordinate of the point
+ @param z The z coordinate of the point
+ @return The coordinates of the chunk
+*/
+static inline chunk_coord get_chunk_coord(float x, float z) {
+  return chunk_coord((int32_t)floorf(x / CHUNK_SIZE),
+                     (int32_t)floorf(z / CHUNK_SIZE));
+}
+
+inline terrain::terrain(const texture *tex, const texture *norm)
+    : object(nullptr, 0.0, 0.0, 0.0),
+      noise_shift(glm::linearRand(0.f, NOISE_TEMP),
+                  glm::linearRand(0.f, NOISE_TEMP)),
+      tex(tex), norm(norm), revision(0), focus(0.0), centered(false), stopping(false) {
+#ifndef NO_THREADS
+  for (uint8_t i = 0; i < CHUNK_WORKERS; i++) {
+    workers.push_back(std::thread(&terrain::work, this));
+  }
+#endif
+}
+
+inline terrain::~terrain() {
+  {
+    std::lock_guard<std::mutex> lock(chunk_mutex);
+    stopping = true;
+  }
+  job_available.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+  for (auto &pair : ready) {
+    delete pair.second;
+  }
+  for (auto &pair : chunks) {
+    delete pair.second;
+  }
+}
+
+inline random_floor *terrain::generate(chunk_coord coord) const {
+  glm::vec2 origin(coord.first * CHUNK_SIZE, coord.second * CHUNK_SIZE);
+  return new random_floor(tex, norm, origin.x, 0.0, origin.y, CHUNK_SIZE,
+                          CHUNK_SIZE, CHUNK_RESOLUTION, noise_shift + origin);
+}
+
+inline void terrain::work() {
+  std::unique_lock<std::mutex> lock(chunk_mutex);
+  while (true) {
+    job_available.wait(lock, [this] { return stopping || !jobs.empty(); });
+    if (stopping) {
+      return;
+    }
+    chunk_coord coord = jobs.front();
+    jobs.pop_front();
+    if (wanted.count(coord) == 0) {
+      continue; // evicted before we got to it
+    }
+    lock.unlock();
+    random_floor *chunk = generate(coord);
+    lock.lock();
+    ready.push_back(std::make_pair(coord, chunk));
+  }
+}
+
+inline void terrain::update(glm::vec3 position) {
+  chunk_coord new_center = get_chunk_coord(position.x, position.z);
+  {
+    std::lock_guard<std::mutex> lock(chunk_mutex);
+    focus = position;
+    if (centered && new_center == center) {
+      return;
+    }
+    center = new_center;
+    centered = true;
+    std::set<chunk_coord> new_wanted;
+    for (int32_t x = -CHUNK_RADIUS; x <= CHUNK_RADIUS; x++) {
+      for (int32_t z = -CHUNK_RADIUS; z <= CHUNK_RADIUS; z++) {
+        chunk_coord coord(center.first + x, center.second + z);
+        new_wanted.insert(coord);
+        if (wanted.count(coord) == 0) {
+          jobs.push_back(coord);
+        }
+      }
+    }
+    wanted.swap(new_wanted);
+  }
+  job_available.notify_all();
+}
+
+inline void terrain::deinit() const {
+  for (const auto &pair : chunks) {
+    pair.second->deinit();
+  }
+}
+
+inline void terrain::begin_frame() const {
+  object::begin_frame();
+  std::lock_guard<std::mutex> lock(chunk_mutex);
+#ifdef NO_THREADS
+  // no workers, so we generate the chunks here, a few per frame
+  for (uint8_t i = 0; i < CHUNK_UPLOADS && !jobs.empty(); i++) {
+    chunk_coord coord = jobs.front();
+    jobs.pop_front();
+    if (wanted.count(coord) != 0) {
+      ready.push_back(std::make_pair(coord, generate(coord)));
+    }
+  }
+#endif
+  for (auto it = chunks.begin(); it != chunks.end();) {
+    if (wanted.count(it->first) == 0) {
+      it->second->deinit();
+      delete it->second;
+      it = chunks.erase(it);
+      revision++;
+    } else {
+      it++;
+    }
+  }
+  for (uint8_t uploaded = 0; uploaded < CHUNK_UPLOADS && !ready.empty();) {
+    std::pair<chunk_coord, random_floor *> pair = ready.front();
+    ready.pop_front();
+    if (wanted.count(pair.first) == 0 || chunks.count(pair.first) != 0) {
+      delete pair.second; // evicted, or a duplicate of a loaded chunk
+      continue;
+    }
+    pair.second->init();
+    chunks[pair.first] = pair.second;
+    revision++;
+    uploaded++;
+  }
+  const uint32_t samples = FLOOR_SAMPLES(CHUNK_SIZE, CHUNK_RESOLUTION);
+  for (const auto &pair : chunks) {
+    chunk_coord coord = pair.first;
+    uint8_t lod = get_lod(coord, focus);
+    uint8_t stitch = 0;
+    if (get_lod(chunk_coord(coord.first - 1, coord.second), focus) > lod) {
+      stitch |= SIDE_NEG_X;
+    }
+    if (get_lod(chunk_coord(coord.first + 1, coord.second), focus) > lod) {
+      stitch |= SIDE_POS_X;
+    }
+    if (get_lod(chunk_coord(coord.first, coord.second - 1), focus) > lod) {
+      stitch |= SIDE_NEG_Z;
+    }
+    if (get_lod(chunk_coord(coord.first, coord.second + 1), focus) > lod) {
+      stitch |= SIDE_POS_Z;
+    }
+    const grid_lod *level =
+        grid_lod_cache::shared().get(samples, samples, lod, stitch);
+    if (pair.second->get_grid_lod() != level) {
+      pair.second->set_lod(level);
+      revision++; // the surface the cached shadows were drawn of changed
+    }
+  }
+}
+
+inline void terrain::render(const camera *target_camera,
+                            const shader *current_shader,
+                            uint32_t tex_off) const {
+  // only this thread modifies the loaded chunks and their levels, so we can
+  // read them unlocked
+  for (const auto &pair : chunks) {
+    pair.second->render(target_camera, current_shader, tex_off);
+  }
+}
+
+inline void terrain::render_shadow(const shader *current_shader,
+                                   uint32_t tex_off) const {
+  render(nullptr, current_shader, tex_off);
+}
+
+inline uint32_t terrain::get_revision() const { return revision; }
+
+inline void terrain::draw_occluders(occlusion_buffer &buffer) const {
+  // only this thread modifies the loaded chunks, so we can read them unlocked
+  for (const auto &pair : chunks) {
+    pair.second->draw_occluders(buffer);
+  }
+}
+
+inline uint8_t terrain::get_lod(chunk_coord coord, glm::vec3 focus) {
+  glm::vec2 origin(coord.first * CHUNK_SIZE, coord.second * CHUNK_SIZE);
+  // distance from the focus to the closest point of the chunk
+  glm::vec2 outside(
+      std::max(std::max(origin.x - focus.x, focus.x - origin.x - CHUNK_SIZE),
+               0.f),
+      std::max(std::max(origin.y - focus.z, focus.z - origin.y - CHUNK_SIZE),
+               0.f));
+  uint32_t lod = glm::length(outside) / TERRAIN_LOD_DISTANCE;
+  return std::min(lod, (uint32_t)(TERRAIN_LODS - 1));
+}
+
+inline float terrain::sample_noise(float x, float y) const {
+  {
+    std::lock_guard<std::mutex> lock(chunk_mutex);
+    auto it = chunks.find(get_chunk_coord(x, y));
+    if (it != chunks.end()) {
+      return it->second->sample_noise(x, y);
+    }
+  }
+  return ::sample_noise(x + noise_shift.x, y + noise_shift.y);
+}
+
+inline bool terrain::check_point(glm::vec3 point) const {
+  return point.y < sample_noise(point.x, point.z);
+}
+
+inline bool terrain::check_line(glm::vec3 a, glm::vec3 b) const {
+  return check_line(a, b, nullptr);
+}
+
+inline bool terrain::check_line(glm::vec3 a, glm::vec3 b,
+                                glm::vec3 *hit) const {
+  glm::vec3 direction = b - a;
+  std::lock_guard<std::mutex> lock(chunk_mutex);
+  return traverse_grid(
+      glm::vec2(a.x, a.z) / (float)CHUNK_SIZE,
+      glm::vec2(b.x, b.z) / (float)CHUNK_SIZE,
+      [&](int32_t x, int32_t z, float enter, float exit) {
+        glm::vec3 from = a + direction * enter, to = a + direction * exit;
+        auto it = chunks.find(chunk_coord(x, z));
+        if (it != chunks.end()) {
+          return it->second->check_line_floor(from, to, hit);
+        }
+        // not loaded, so we march through the noise itself
+        float distance = glm::length(to - from);
+        for (float i = 0; i <= distance + CHUNK_RESOLUTION;
+             i += CHUNK_RESOLUTION) {
+          glm::vec3 point =
+              distance == 0.0f ? from
+                               : from + (to - from) * std::min(i / distance,
+                                                               1.0f);
+          if (point.y < ::sample_noise(point.x + noise_shift.x,
+                                       point.z + noise_shift.y)) {
+            if (hit != nullptr) {
+              *hit = point;
+            }
+            return true;
+          }
+        }
+        return false;
+      });
+}
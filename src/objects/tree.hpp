@@ -1,5 +1,6 @@
 #pragma once
 
+#include <limits>
 #include <random>
 
 #include "../engine/engine.hpp"
@@ -14,6 +15,9 @@
 #define BRANCH_MIN_LENGTH 0.5f
 #define BRANCH_MAX_LENGTH 1.2f
 #define BRANCH_SEGMENTS 2
+// the number of lower detail levels, each with half the sides and a quarter
+// of the rings of the previous one
+#define TREE_LODS 2
 
 /*!
  @brief A procedurally generated model of a tree
@@ -21,6 +25,7 @@
 class tree_model : public model {
 private:
   std::vector<std::pair<glm::vec3, glm::vec3>> branch_points;
+  float trunk_radius, trunk_height;
 
 public:
   /*!
@@ -39,32 +44,79 @@ public:
    @return A vector of point pairs
   */
   const std::vector<std::pair<glm::vec3, glm::vec3>> &get_branch_points() const;
+  /*!
+   @brief Gets the radius of the cylinder that fits within the trunk
+   @return The radius, smaller than that of any ring of the bark
+  */
+  float get_trunk_radius() const;
+  /*!
+   @brief Gets the height of the bark, below the tip
+   @return The height of the topmost ring of the bark
+  */
+  float get_trunk_height() const;
 };
 
+/*!
+ @brief Generates the indices of the bark and the tip of a tree at a reduced
+  level of detail
+ @details Only every ring_step-th point of every segment_step-th ring is used,
+  along with the topmost ring, so the vertices stay the same
+ @param num_segments The number of rings of the bark
+ @param ring_step The distance between the used points of a ring, has to
+  divide RING_POINTS
+ @param segment_step The distance between the used rings
+ @return The indices of the bark
+*/
+static inline std::vector<unsigned int>
+generate_bark_indices(uint8_t num_segments, uint8_t ring_step,
+                      uint8_t segment_step) {
+  std::vector<uint32_t> rings;
+  for (uint32_t y = 0; y + 1 < num_segments; y += segment_step) {
+    rings.push_back(y);
+  }
+  rings.push_back(num_segments - 1);
+  uint8_t sides = RING_POINTS / ring_step;
+  std::vector<unsigned int> indices;
+  indices.reserve((rings.size() - 1) * sides * 6 + sides * 3);
+  for (size_t i = 0; i + 1 < rings.size(); i++) {
+    uint32_t lower = rings[i] * RING_POINTS, upper = rings[i + 1] * RING_POINTS;
+    for (uint8_t x = 0; x < RING_POINTS; x += ring_step) {
+      uint8_t next = (x + ring_step) % RING_POINTS;
+      indices.push_back(lower + x);
+      indices.push_back(lower + next);
+      indices.push_back(upper + x);
+      indices.push_back(upper + x);
+      indices.push_back(lower + next);
+      indices.push_back(upper + next);
+    }
+  }
+  uint32_t top = (num_segments - 1) * RING_POINTS;
+  for (uint8_t x = 0; x < RING_POINTS; x += ring_step) {
+    indices.push_back(top + x);
+    indices.push_back(top + (x + ring_step) % RING_POINTS);
+    indices.push_back(num_segments * RING_POINTS);
+  }
+  return indices;
+}
+
 static inline void add_data(std::vector<float> &data, glm::vec3 vertex,
                             glm::vec2 texel, glm::vec3 normal,
                             glm::vec3 tangent, glm::vec3 bitangent) {
-  data.push_back(vertex.x);
-  data.push_back(vertex.y);
-  data.push_back(vertex.z);
-  data.push_back(texel.x);
-  data.push_back(texel.y);
-  data.push_back(normal.x);
-  data.push_back(normal.y);
-  data.push_back(normal.z);
-  data.push_back(tangent.x);
-  data.push_back(tangent.y);
-  data.push_back(tangent.z);
-  data.push_back(bitangent.x);
-  data.push_back(bitangent.y);
-  data.push_back(bitangent.z);
+  const float line[MODEL_LINE_SIZE] = {
+      MODEL_LINE(vertex.x, vertex.y, vertex.z, texel.x, texel.y, normal.x,
+                 normal.y, normal.z, tangent.x, tangent.y, tangent.z,
+                 bitangent.x, bitangent.y, bitangent.z)};
+  data.insert(data.end(), line, line + MODEL_LINE_SIZE);
 }
 
 inline tree_model::tree_model(uint8_t num_segments, float segment_height,
                               float root_radius, float variance,
-                              float tip_offset) {
+                              float tip_offset)
+    : trunk_radius(std::numeric_limits<float>::infinity()),
+      trunk_height((num_segments - 1) * segment_height) {
   // https://math.stackexchange.com/questions/4459356/find-n-evenly-spaced-points-on-circle-with-radius-r
   std::vector<glm::vec2> ring_points; // first we generate a flat ring
+  ring_points.reserve(RING_POINTS);
   for (uint8_t i = 0; i < RING_POINTS; i++) {
     float angle = (2 * M_PI * i) / RING_POINTS;
     ring_points.push_back(glm::vec2(cos(angle), sin(angle)));
@@ -72,10 +124,12 @@ inline tree_model::tree_model(uint8_t num_segments, float segment_height,
   // future branch definitions
   // then we copy this ring for each segment
   std::vector<glm::vec3> points;
+  points.reserve(num_segments * RING_POINTS);
   for (uint8_t i = 0; i < num_segments; i++) {
     float radiance = glm::linearRand(-variance, variance);
     float radius = root_radius + radiance;
     root_radius += radiance;
+    trunk_radius = std::min(trunk_radius, radius);
     for (size_t j = 0; j < ring_points.size(); j++) {
       points.push_back(glm::vec3(radius * ring_points[j].x, i * segment_height,
                                  radius * ring_points[j].y));
@@ -100,6 +154,13 @@ inline tree_model::tree_model(uint8_t num_segments, float segment_height,
       }
     }
   }
+  // with the branches known, the geometry can be allocated exactly
+  size_t branch_vertices = BARK_POINTS * BRANCH_SEGMENTS + 1;
+  size_t branch_indices = BARK_POINTS * BRANCH_SEGMENTS * 6 + BARK_POINTS * 3;
+  data.reserve((points.size() + 1 + branch_points.size() * branch_vertices) *
+               MODEL_LINE_SIZE);
+  indices.reserve((num_segments - 1) * RING_POINTS * 6 + RING_POINTS * 3 +
+                  branch_points.size() * branch_indices);
   // then we use the rings to generate the bark
   for (size_t i = 0; i < points.size(); i++) {
     uint8_t ring_index = i % RING_POINTS;
@@ -121,6 +182,8 @@ inline tree_model::tree_model(uint8_t num_segments, float segment_height,
       indices.push_back(point_off + RING_POINTS + (x + 1) % RING_POINTS);
     }
   }
+  // the flat sides of the rings lie a bit within their radius
+  trunk_radius *= cosf(M_PI / RING_POINTS);
   float tip_y = num_segments * segment_height + tip_offset;
   negbounds = glm::vec3(-root_radius, 0.0, -root_radius);
   bounds = glm::vec3(root_radius, tip_y, root_radius);
@@ -176,10 +239,35 @@ inline tree_model::tree_model(uint8_t num_segments, float segment_height,
       indices.push_back(point_off + BARK_POINTS);
     }
   }
+  // the lower detail levels, over the same vertices
+  lod_indices.reserve(TREE_LODS);
+  for (uint8_t level = 1; level <= TREE_LODS; level++) {
+    std::vector<unsigned int> level_indices =
+        generate_bark_indices(num_segments, 1 << level, 1 << (2 * level));
+    // the branches shrink to cones of half the sides, and then disappear
+    // within the leaves
+    if (level == 1) {
+      for (size_t i = 0; i < branch_points.size(); i++) {
+        uint32_t root =
+            points.size() + 1 + (i * (BARK_POINTS * BRANCH_SEGMENTS + 1));
+        for (uint8_t j = 0; j < BARK_POINTS; j += 2) {
+          level_indices.push_back(root + j);
+          level_indices.push_back(root + (j + 2) % BARK_POINTS);
+          level_indices.push_back(root + BARK_POINTS * BRANCH_SEGMENTS);
+        }
+      }
+    }
+    lod_indices.push_back(std::move(level_indices));
+  }
+  optimize();
 }
 
 inline tree_model::~tree_model() {}
 
+inline float tree_model::get_trunk_radius() const { return trunk_radius; }
+
+inline float tree_model::get_trunk_height() const { return trunk_height; }
+
 inline const std::vector<std::pair<glm::vec3, glm::vec3>> &
 tree_model::get_branch_points() const {
   return branch_points;
@@ -227,6 +315,12 @@ public:
    @return The y position of the tip of the tree
   */
   float get_tip_y() const;
+  bool get_world_bounds(glm::vec3 &low, glm::vec3 &high) const;
+  /*!
+   @brief Draws the largest box that fits within the trunk
+   @param buffer The buffer to draw the box into
+  */
+  void draw_occluders(occlusion_buffer &buffer) const;
 };
 
 inline random_tree::random_tree(double xpos, double ypos, double zpos)
@@ -238,6 +332,7 @@ inline random_tree::random_tree(double xpos, double ypos, double zpos)
            tip_y),
       tex(TEXTURE_PATH("poplar.jpg")), norm(TEXTURE_PATH("poplar_normal.jpg")) {
   tree.init();
+  tree.release_data();
   add_texture(&tex, "texture0");
   add_texture(&norm, "normal0");
 }
@@ -250,3 +345,23 @@ random_tree::get_leaves_points() const {
 }
 
 inline float random_tree::get_tip_y() const { return tip_y; }
+
+inline bool random_tree::get_world_bounds(glm::vec3 &low,
+                                          glm::vec3 &high) const {
+  object::get_world_bounds(low, high);
+  // the bounds only cover the trunk, for collisions, so we add the branches
+  glm::vec3 reach(BRANCH_MAX_LENGTH + BRANCH_RADIUS, SEGMENT_HEIGHT,
+                  BRANCH_MAX_LENGTH + BRANCH_RADIUS);
+  low -= reach;
+  high += reach;
+  return true;
+}
+
+inline void random_tree::draw_occluders(occlusion_buffer &buffer) const {
+  // the square inscribed in the cross section of the trunk, even at the
+  // coarsest detail level, where the rings are squares turned on their side
+  float half = tree.get_trunk_radius() * 0.5f;
+  buffer.draw_box(glm::vec3(-half, 0.0f, -half),
+                  glm::vec3(half, tree.get_trunk_height(), half),
+                  get_model_matrix());
+}
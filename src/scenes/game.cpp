@@ -1,5 +1,6 @@
 #include "game.hpp"
 #include <iostream>
+#include <limits>
 
 #define CAMERA_Y_OFFSET 1.0f
 #define CAMERA_SPEED 10.0f
@@ -8,6 +9,10 @@
 #define LIGHT_RANGE 30.0f
 #define LIGHT_FOV glm::radians(70.f)
 
+#define MOON_DIRECTION glm::vec3(-0.4f, -1.0f, -0.3f)
+#define MOON_COLOR glm::vec3(0.08f, 0.09f, 0.14f)
+
+// the size of the area populated with trees and grass
 #define FLOOR_SIZE 100
 #define TREE_COUNT 20
 #define GRASS_COUNT 100
@@ -42,6 +47,12 @@
 
 #define SPAWNING_RADIUS 3.0f
 
+// past this distance trees are drawn as impostors, just beyond the reach of
+// the flashlight, which impostors aren't lit by
+#define IMPOSTOR_DISTANCE 35.0f
+// the number of trees baked into the impostor atlas
+#define IMPOSTOR_VARIANTS 4
+
 #define CAMERA_COLLISION_EPS (RENDER_MIN * 5e2f + 1.f)
 
 game::game(std::list<boid *> &boids)
@@ -57,8 +68,14 @@ game::~game() {
   delete this->sky;
 
   delete this->lght;
+  delete this->moon;
 
   delete this->textured_shader;
+  delete this->leaf_depth_shader;
+  delete this->impostor_shader;
+  delete this->impostor_depth_shader;
+  delete this->tree_impostors;
+  delete this->tree_atlas;
   delete this->skybox_shader;
 
   for (auto &tri : boids) {
@@ -66,6 +83,8 @@ game::~game() {
   }
 
   delete this->floor1;
+  delete this->floor_tex;
+  delete this->floor_norm;
 }
 
 void game::init(camera *target_camera) {
@@ -75,12 +94,20 @@ void game::init(camera *target_camera) {
 
   textured_shader =
       new shader(SHADER_PATH("textured.vert"), SHADER_PATH("textured.frag"));
+  textured_shader->set_opaque(true);
   leaf_shader =
       new shader(SHADER_PATH("leaves.vert"), SHADER_PATH("leaves.frag"), false);
+  leaf_depth_shader = new shader(SHADER_PATH("leaves.vert"),
+                                 SHADER_PATH("leaves_depth.frag"), false);
+  leaf_shader->set_alpha_tested(true);
+  leaf_shader->set_depth_shader(leaf_depth_shader);
   simple_textured_shader = new shader(SHADER_PATH("textured.vert"),
                                       SHADER_PATH("simple_textured.frag"));
-  floor1 = new random_floor(FLOOR_SIZE / -2., 0.0, FLOOR_SIZE / -2., FLOOR_SIZE,
-                            FLOOR_SIZE, 0.5);
+  floor_tex = new texture(TEXTURE_PATH("grass.jpg"));
+  floor_norm = new texture(TEXTURE_PATH("grass_normal.png"));
+  floor1 = new terrain(floor_tex, floor_norm);
+  floor1->update(target_camera->get_position());
+  floor1->set_static(true);
   this->add_object(textured_shader, floor1);
   target_camera->set_position(
       glm::vec3(0.0, floor1->sample_noise(0.0, 0.0) + CAMERA_Y_OFFSET, 0.0));
@@ -90,6 +117,8 @@ void game::init(camera *target_camera) {
   lght = new light(target_camera->get_position(), glm::vec3(LIGHT_STRENGTH),
                    LIGHT_FOV, LIGHT_RANGE, true);
   this->add_light(lght);
+  moon = new directional_light(MOON_DIRECTION, MOON_COLOR);
+  this->set_sun(moon);
   flash_image = new texture(TEXTURE_PATH("muzzle_flash.png"));
   flash_sprite = new object(model_loader::get().get_wall(), 0.f, 0.f, 0.f);
   flash_sprite->set_active(false);
@@ -122,7 +151,8 @@ void game::init(camera *target_camera) {
                   glm::linearRand(-SPAWN_RADIUS, SPAWN_RADIUS));
     for (int i = 0; i < FLOCK_SIZE; ++i) {
       glm::vec3 pos = center + glm::ballRand(FLOCK_RADIUS);
-      boid *tri = new boid(boid_tex, boid_norm, pos.x, pos.y, pos.z, spec);
+      boid *tri =
+          new boid(world, boid_tex, boid_norm, pos.x, pos.y, pos.z, spec);
       boids.push_back(tri);
       this->add_object(textured_shader, tri);
     }
@@ -131,6 +161,9 @@ void game::init(camera *target_camera) {
   // tree spawning
 
   leaf_tex = create_random_leaf_texture(LEAF_IMAGE_SIZE, COLOR_VARIANCE);
+  leaf_reach = 0.0f;
+  // where the leaves of every tree start in leaf_points
+  std::vector<size_t> leaf_starts;
 
   for (int x = FLOOR_SIZE / -2; x < FLOOR_SIZE / 2;
        x += FLOOR_SIZE / TREE_COUNT) {
@@ -139,8 +172,10 @@ void game::init(camera *target_camera) {
       glm::vec2 pos = glm::vec2(x, z) + glm::circularRand(SPAWNING_RADIUS);
       random_tree *tree =
           new random_tree(pos.x, floor1->sample_noise(pos.x, pos.y), pos.y);
+      tree->set_static(true);
       this->add_object(textured_shader, tree);
       trees.push_back(tree);
+      leaf_starts.push_back(leaf_points.size());
       for (auto &pair : tree->get_leaves_points()) {
         glm::vec3 start_pos = pair.first + tree->get_position();
         glm::vec3 step = (pair.second - pair.first) / (float)LEAVES_PER_BRANCH;
@@ -148,14 +183,63 @@ void game::init(camera *target_camera) {
         for (uint8_t i = 1; i < LEAVES_PER_BRANCH; i++) {
           leaf_points.push_back((start_pos + step * (float)i) +
                                 glm::ballRand(LEAF_SIZE));
+          glm::vec3 offset = leaf_points.back() - tree->get_position();
+          leaf_reach =
+              std::max(leaf_reach, glm::length(glm::vec2(offset.x, offset.z)));
         }
       }
     }
   }
 
   leaves_obj = new leaves(leaf_tex, leaf_points);
+  leaves_obj->set_static(true);
   this->add_object(leaf_shader, leaves_obj);
   leaves_obj->set_scale(LEAF_SIZE);
+
+  // distant trees are drawn as billboards of a few of the trees, baked from
+  // all around
+  leaf_starts.push_back(leaf_points.size());
+  uint8_t variants = std::min((size_t)IMPOSTOR_VARIANTS, trees.size());
+  glm::vec3 low(std::numeric_limits<float>::infinity()), high = -low;
+  for (uint8_t variant = 0; variant < variants; variant++) {
+    glm::vec3 tree_low, tree_high;
+    trees[variant]->get_world_bounds(tree_low, tree_high);
+    low = glm::min(low, tree_low - trees[variant]->get_position());
+    high = glm::max(high, tree_high - trees[variant]->get_position());
+  }
+  // the leaves stick out of the branches
+  tree_atlas = new impostor_atlas(variants, low - glm::vec3(LEAF_SIZE),
+                                  high + glm::vec3(LEAF_SIZE));
+  shader bark_bake_shader(SHADER_PATH("textured.vert"),
+                          SHADER_PATH("impostor_bake.frag"));
+  shader leaf_bake_shader(SHADER_PATH("leaves.vert"),
+                          SHADER_PATH("impostor_bake.frag"), false);
+  bark_bake_shader.use();
+  bark_bake_shader.apply_uniform(false, "foliage");
+  leaf_bake_shader.use();
+  leaf_bake_shader.apply_uniform(true, "foliage");
+  for (uint8_t variant = 0; variant < variants; variant++) {
+    leaves variant_leaves(
+        leaf_tex,
+        std::vector<glm::vec3>(leaf_points.begin() + leaf_starts[variant],
+                               leaf_points.begin() + leaf_starts[variant + 1]));
+    variant_leaves.set_scale(LEAF_SIZE);
+    tree_atlas->bake(variant, trees[variant]->get_position(),
+                     {{&bark_bake_shader, trees[variant]},
+                      {&leaf_bake_shader, &variant_leaves}});
+  }
+  std::vector<glm::vec3> tree_points;
+  for (auto &tree : trees) {
+    tree_points.push_back(tree->get_position());
+  }
+  impostor_shader = new shader(SHADER_PATH("impostor.vert"),
+                               SHADER_PATH("impostor.frag"), false);
+  impostor_depth_shader = new shader(SHADER_PATH("impostor.vert"),
+                                     SHADER_PATH("impostor_depth.frag"), false);
+  impostor_shader->set_alpha_tested(true);
+  impostor_shader->set_depth_shader(impostor_depth_shader);
+  tree_impostors = new impostors(tree_atlas, tree_points);
+  this->add_object(impostor_shader, tree_impostors);
   // grass generation
 
   for (int x = FLOOR_SIZE / -2; x < FLOOR_SIZE / 2;
@@ -169,6 +253,7 @@ void game::init(camera *target_camera) {
   }
 
   grass_obj = new grass(grasstex, grass_points);
+  grass_obj->set_static(true);
   this->add_object(leaf_shader, grass_obj);
 
   skybox_shader =
@@ -182,6 +267,13 @@ void game::init(camera *target_camera) {
   scene::init(target_camera);
 }
 
+void game::deinit() {
+  floor1->deinit();
+  // the chunks of every terrain draw with these
+  grid_lod_cache::shared().clear();
+  scene::deinit();
+}
+
 void game::update(camera *target_camera, double delta_time, double) {
 
   glm::vec3 camera_position = target_camera->get_position();
@@ -221,15 +313,27 @@ void game::update(camera *target_camera, double delta_time, double) {
       }
     }
   }
+  floor1->update(camera_position);
+  // the trees past IMPOSTOR_DISTANCE are left to their impostors, but still
+  // cast their cached shadows, which the camera moving doesn't invalidate
+  for (auto &tree : trees) {
+    glm::vec3 position = tree->get_position();
+    tree->set_visible(glm::distance(glm::vec2(position.x, position.z),
+                                    glm::vec2(camera_position.x,
+                                              camera_position.z)) <=
+                      IMPOSTOR_DISTANCE);
+  }
+  tree_impostors->set_cutoff(camera_position, IMPOSTOR_DISTANCE);
+  // the leaves of a drawn tree can reach past it
+  leaves_obj->set_cutoff(camera_position, IMPOSTOR_DISTANCE + leaf_reach);
   if (rot_left) {
     target_camera->rotate(glm::vec3(0.0, 0.0, -delta_time));
   } else if (rot_right) {
     target_camera->rotate(glm::vec3(0.0, 0.0, delta_time));
   }
 
-  for (auto &tri : boids) {
-    tri->update((const std::list<const boid *> &)boids, this, delta_time);
-  }
+  update_flocks(world, this, delta_time);
+  sync_transforms(world);
 
   gun->update(delta_time);
   if (shooting && gun->shoot()) {
@@ -238,6 +342,7 @@ void game::update(camera *target_camera, double delta_time, double) {
       if (tri->check_line(camera_position,
                           camera_position + camera_front * 100.0f)) {
         this->remove_object(tri);
+        world.destroy(tri->get_entity());
         tri->set_active(false);
         boids.remove(tri);
         break;
@@ -6,9 +6,11 @@
 #include "../objects/debug_cube.hpp"
 #include "../objects/debug_wall.hpp"
 #include "../objects/grass.hpp"
+#include "../objects/impostors.hpp"
 #include "../objects/leaves.hpp"
 #include "../objects/random_floor.hpp"
 #include "../objects/shotgun.hpp"
+#include "../objects/terrain.hpp"
 #include "../objects/tree.hpp"
 
 /*!
@@ -22,17 +24,29 @@ private:
   double xpos, ypos;
   skybox *sky;
   light *lght, *muzzle;
-  shader *textured_shader, *skybox_shader, *leaf_shader,
-      *simple_textured_shader;
+  directional_light *moon;
+  shader *textured_shader, *skybox_shader, *leaf_shader, *leaf_depth_shader,
+      *simple_textured_shader, *impostor_shader, *impostor_depth_shader;
   std::list<boid *> &boids;
+  /*!
+   @brief The entities simulated by the game
+  */
+  registry world;
   bool is_shooting;
   glm::vec3 shoot_direction;
-  random_floor *floor1;
+  terrain *floor1;
   std::vector<boid_species *> species;
   std::vector<random_tree *> trees;
-  texture *boid_tex, *boid_norm, *leaf_tex, *grasstex, *flash_image;
+  texture *boid_tex, *boid_norm, *leaf_tex, *grasstex, *flash_image,
+      *floor_tex, *floor_norm;
   std::vector<glm::vec3> leaf_points, grass_points;
   leaves *leaves_obj;
+  /*!
+   @brief The farthest any leaf is from its tree, horizontally
+  */
+  float leaf_reach;
+  impostor_atlas *tree_atlas;
+  impostors *tree_impostors;
   grass *grass_obj;
   object *flash_sprite;
   shotgun *gun;
@@ -49,6 +63,7 @@ public:
    @param target_camera The camera that will be used to render the scene
   */
   void init(camera *target_camera);
+  void deinit();
   /*!
    @brief Performs a single game tick
    @param target_camera The camera used
@@ -10,7 +10,10 @@ static const glm::vec2 radar_mid_point =
 
 radar::radar(std::list<boid *> &boids)
     : scene(glm::vec3(0.1, 0.1, 0.1), glm::vec3(0.0)), boids(boids),
-      last_time(glfwGetTime()) {}
+      last_time(glfwGetTime()) {
+  // the radar is blitted to the window, which needs a single sample
+  samples = 1;
+}
 
 void radar::draw_line(uint16_t x, uint16_t y, glm::vec3 color,
                       uint8_t thickness, uint8_t *data) {